@@ -33,8 +33,8 @@ if [ "$BOOST_ASIO_OLD" = "1" ]; then
 fi
 
 echo "Building server and C++ client..."
-"$CXX" -std=c++17 -O2 "${EXTRA_DEFS[@]}" -I"$ROOT/src" -I"$BOOST_PREFIX/include" -I"$WS_INCLUDE" \
-  "$ROOT/src/engine.cpp" "$ROOT/server/ws_server.cpp" -o "$SERVER_BIN" \
+"$CXX" -std=c++17 -O2 "${EXTRA_DEFS[@]}" -I"$ROOT/src" -I"$ROOT/server" -I"$BOOST_PREFIX/include" -I"$WS_INCLUDE" \
+  "$ROOT/src/engine.cpp" "$ROOT/server/protocol.cpp" "$ROOT/server/match_log.cpp" "$ROOT/server/ws_server.cpp" -o "$SERVER_BIN" \
   -L"$BOOST_PREFIX/lib" -lboost_system -pthread
 
 "$CXX" -std=c++17 -O2 "${EXTRA_DEFS[@]}" -I"$BOOST_PREFIX/include" -I"$WS_INCLUDE" \
@@ -0,0 +1,177 @@
+#include "match_log.h"
+
+#include <optional>
+#include <sstream>
+#include <vector>
+
+#include "protocol.h"
+
+namespace tigerdragon::protocol {
+
+bool MatchLogWriter::Open(const std::string& path, const MatchConfig& config, const std::string& room_id) {
+  out_.open(path);
+  if (!out_.is_open()) {
+    return false;
+  }
+  out_ << "match " << config.players << " " << config.seed << " " << config.first_start_player << " "
+       << config.target_score << " " << room_id << "\n";
+  out_ << "rules " << FormatScoreRules(config.score_table) << "\n";
+  return true;
+}
+
+void MatchLogWriter::Write(const std::string& tag, const std::string& payload) {
+  if (out_.is_open()) {
+    out_ << tag << " " << payload << "\n";
+  }
+}
+
+void MatchLogWriter::Write(const std::string& tag, int seat, const std::string& payload) {
+  if (out_.is_open()) {
+    out_ << tag << " " << seat << " " << payload << "\n";
+  }
+}
+
+namespace {
+
+class MatchReplayer {
+ public:
+  MatchReplayResult Run(const std::string& text) {
+    std::istringstream lines(text);
+    std::string line;
+    while (result_.ok && std::getline(lines, line)) {
+      ++result_.line;
+      if (!line.empty()) {
+        Step(line);
+      }
+    }
+    if (result_.ok && expected_.has_value()) {
+      Fail("log ends before " + expected_tag_);
+    }
+    return result_;
+  }
+
+ private:
+  void Step(const std::string& line) {
+    const size_t space = line.find(' ');
+    const std::string tag = line.substr(0, space);
+    const std::string rest = space == std::string::npos ? "" : line.substr(space + 1);
+
+    if (expected_.has_value() && tag != expected_tag_) {
+      Fail("expected " + expected_tag_ + ", got " + tag);
+      return;
+    }
+    if (tag == "match") {
+      if (started_) {
+        Fail("duplicate match header");
+        return;
+      }
+      std::istringstream fields(rest);
+      fields >> config_.players >> config_.seed >> config_.first_start_player >> config_.target_score >> room_id_;
+      if (!fields || config_.players < 2 || config_.players > kMaxPlayers || config_.first_start_player < 0 ||
+          config_.first_start_player >= config_.players) {
+        Fail("bad match header");
+      }
+    } else if (tag == "rules") {
+      if (!ParseScoreRulesLine(rest, &config_.score_table)) {
+        Fail("bad score rules");
+        return;
+      }
+      match_ = CreateMatch(config_);
+      started_ = true;
+      discards_.assign(config_.players, {});
+    } else if (!started_) {
+      Fail("missing match header");
+    } else if (tag == "state") {
+      const size_t split = rest.find(' ');
+      const int seat = std::atoi(rest.substr(0, split).c_str());
+      const std::string payload = split == std::string::npos ? "" : rest.substr(split + 1);
+      if (seat < -1 || seat >= config_.players) {
+        Fail("state for seat " + std::to_string(seat));
+        return;
+      }
+      Compare(BuildStateMessage(room_id_, result_.turn, match_, seat), payload);
+    } else if (tag == "choice") {
+      const size_t split = rest.find(' ');
+      const int seat = std::atoi(rest.substr(0, split).c_str());
+      Choice(seat, split == std::string::npos ? "" : rest.substr(split + 1));
+    } else if (tag == "round_result" || tag == "game_over") {
+      if (!expected_.has_value()) {
+        Fail("unexpected " + tag);
+        return;
+      }
+      const std::string expected = *expected_;
+      expected_.reset();
+      Compare(expected, rest);
+      if (tag == "round_result" && result_.ok) {
+        result_.round = match_.round_index;
+        result_.turn = 0;
+      }
+      if (tag == "round_result" && match_.finished) {
+        expected_ = BuildGameOverMessage(match_);
+        expected_tag_ = "game_over";
+      }
+    } else {
+      Fail("unknown tag " + tag);
+    }
+  }
+
+  void Choice(int seat, const std::string& token) {
+    if (match_.finished) {
+      Fail("choice after match end");
+      return;
+    }
+    if (seat != match_.round.current_player) {
+      Fail("choice from seat " + std::to_string(seat) + " but player " +
+           std::to_string(match_.round.current_player) + " is to move");
+      return;
+    }
+    const std::optional<Action> action = ParseChoice(match_.round, token);
+    if (!action.has_value()) {
+      Fail("illegal choice '" + token + "'");
+      return;
+    }
+    if (action->type != Action::Type::Pass) {
+      discards_[seat].push_back(DiscardRecord{action->tile, action->type});
+    }
+    RoundResult round;
+    if (!ApplyMatchAction(match_, action.value(), &round)) {
+      Fail("engine rejected '" + token + "'");
+      return;
+    }
+    ++result_.plies;
+    ++result_.turn;
+    if (round.winner >= 0) {
+      expected_ = BuildRoundResultMessage(round, match_, discards_[round.winner]);
+      expected_tag_ = "round_result";
+      discards_.assign(config_.players, {});
+    }
+  }
+
+  void Compare(const std::string& expected, const std::string& logged) {
+    if (expected != logged) {
+      Fail("payload differs\n  logged:   " + logged + "\n  expected: " + expected);
+    }
+  }
+
+  void Fail(const std::string& error) {
+    result_.ok = false;
+    result_.error = error;
+  }
+
+  MatchReplayResult result_;
+  MatchConfig config_;
+  std::string room_id_;
+  MatchState match_;
+  bool started_ = false;
+  std::vector<std::vector<DiscardRecord>> discards_;
+  std::optional<std::string> expected_;
+  std::string expected_tag_;
+};
+
+}  // namespace
+
+MatchReplayResult VerifyMatchLog(const std::string& text) {
+  return MatchReplayer().Run(text);
+}
+
+}  // namespace tigerdragon::protocol
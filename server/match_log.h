@@ -0,0 +1,45 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+
+#include "engine.h"
+
+// Line-oriented log of one served match, enough to replay and check it:
+//
+//   match <players> <seed> <first_start_player> <target_score> <room_id>
+//   rules <score rules, FormatScoreRules>
+//   state <seat> <payload>        seat -1 is the spectator view
+//   choice <seat> <token>         accepted actions only
+//   round_result <payload>
+//   game_over <payload>
+namespace tigerdragon::protocol {
+
+class MatchLogWriter {
+ public:
+  bool Open(const std::string& path, const MatchConfig& config, const std::string& room_id);
+  bool is_open() const { return out_.is_open(); }
+
+  void Write(const std::string& tag, const std::string& payload);
+  void Write(const std::string& tag, int seat, const std::string& payload);
+
+ private:
+  std::ofstream out_;
+};
+
+struct MatchReplayResult {
+  bool ok = true;
+  // First divergence: 1-based log line, rounds completed and turn within
+  // the round at that point.
+  int line = 0;
+  int round = 0;
+  int turn = 0;
+  std::string error;
+  int64_t plies = 0;
+};
+
+// Replays a match log through the engine and compares every logged
+// message with the one the engine state produces.
+MatchReplayResult VerifyMatchLog(const std::string& text);
+
+}  // namespace tigerdragon::protocol
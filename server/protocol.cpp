@@ -0,0 +1,331 @@
+#include "protocol.h"
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+namespace tigerdragon::protocol {
+
+std::string Trim(const std::string& input) {
+  size_t start = 0;
+  while (start < input.size() && std::isspace(static_cast<unsigned char>(input[start]))) {
+    ++start;
+  }
+  size_t end = input.size();
+  while (end > start && std::isspace(static_cast<unsigned char>(input[end - 1]))) {
+    --end;
+  }
+  return input.substr(start, end - start);
+}
+
+std::optional<std::string> ExtractString(const std::string& json, const std::string& key) {
+  std::string pattern = "\"" + key + "\"";
+  size_t pos = json.find(pattern);
+  if (pos == std::string::npos) {
+    return std::nullopt;
+  }
+  pos = json.find(':', pos + pattern.size());
+  if (pos == std::string::npos) {
+    return std::nullopt;
+  }
+  ++pos;
+  while (pos < json.size() && std::isspace(static_cast<unsigned char>(json[pos]))) {
+    ++pos;
+  }
+  if (pos >= json.size() || json[pos] != '"') {
+    return std::nullopt;
+  }
+  ++pos;
+  size_t end = json.find('"', pos);
+  if (end == std::string::npos) {
+    return std::nullopt;
+  }
+  return json.substr(pos, end - pos);
+}
+
+std::optional<int> ExtractInt(const std::string& json, const std::string& key) {
+  std::string pattern = "\"" + key + "\"";
+  size_t pos = json.find(pattern);
+  if (pos == std::string::npos) {
+    return std::nullopt;
+  }
+  pos = json.find(':', pos + pattern.size());
+  if (pos == std::string::npos) {
+    return std::nullopt;
+  }
+  ++pos;
+  while (pos < json.size() && std::isspace(static_cast<unsigned char>(json[pos]))) {
+    ++pos;
+  }
+  size_t end = pos;
+  while (end < json.size() && (std::isdigit(static_cast<unsigned char>(json[end])) || json[end] == '-')) {
+    ++end;
+  }
+  if (end == pos) {
+    return std::nullopt;
+  }
+  return std::stoi(json.substr(pos, end - pos));
+}
+
+std::string ToLabel(TileKind kind) {
+  switch (kind) {
+    case TileKind::Num1:
+      return "1";
+    case TileKind::Num2:
+      return "2";
+    case TileKind::Num3:
+      return "3";
+    case TileKind::Num4:
+      return "4";
+    case TileKind::Num5:
+      return "5";
+    case TileKind::Num6:
+      return "6";
+    case TileKind::Num7:
+      return "7";
+    case TileKind::Num8:
+      return "8";
+    case TileKind::Tiger:
+      return "T";
+    case TileKind::Dragon:
+      return "D";
+  }
+  return "?";
+}
+
+std::optional<TileKind> ParseLabel(const std::string& token) {
+  if (token == "1") return TileKind::Num1;
+  if (token == "2") return TileKind::Num2;
+  if (token == "3") return TileKind::Num3;
+  if (token == "4") return TileKind::Num4;
+  if (token == "5") return TileKind::Num5;
+  if (token == "6") return TileKind::Num6;
+  if (token == "7") return TileKind::Num7;
+  if (token == "8") return TileKind::Num8;
+  if (token == "T" || token == "t") return TileKind::Tiger;
+  if (token == "D" || token == "d") return TileKind::Dragon;
+  return std::nullopt;
+}
+
+std::string JoinInts(const std::vector<int>& values) {
+  std::ostringstream out;
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (i > 0) {
+      out << ",";
+    }
+    out << values[i];
+  }
+  return out.str();
+}
+
+std::string JoinLabels(const std::vector<Tile>& tiles) {
+  std::ostringstream out;
+  for (size_t i = 0; i < tiles.size(); ++i) {
+    if (i > 0) {
+      out << ",";
+    }
+    out << ToLabel(tiles[i].kind);
+  }
+  return out.str();
+}
+
+char SuffixForAction(Action::Type type) {
+  switch (type) {
+    case Action::Type::Attack:
+      return 'A';
+    case Action::Type::Defend:
+      return 'D';
+    case Action::Type::BonusReceive:
+      return 'B';
+    case Action::Type::Pass:
+      break;
+  }
+  return '?';
+}
+
+std::string JoinDiscards(const std::vector<DiscardRecord>& records) {
+  std::ostringstream out;
+  size_t count = 0;
+  for (const auto& record : records) {
+    if (count > 0) {
+      out << ",";
+    }
+    out << ToLabel(record.kind) << SuffixForAction(record.type);
+    ++count;
+  }
+  return out.str();
+}
+
+std::string JoinSet(const std::set<std::string>& values) {
+  std::ostringstream out;
+  size_t i = 0;
+  for (const auto& value : values) {
+    if (i > 0) {
+      out << ",";
+    }
+    out << value;
+    ++i;
+  }
+  return out.str();
+}
+
+std::string JoinPublicDiscards(const std::vector<DiscardRecord>& records) {
+  std::ostringstream out;
+  size_t count = 0;
+  for (const auto& record : records) {
+    if (count > 0) {
+      out << ",";
+    }
+    if (record.type == Action::Type::BonusReceive) {
+      out << "B";
+    } else {
+      out << ToLabel(record.kind) << SuffixForAction(record.type);
+    }
+    ++count;
+  }
+  return out.str();
+}
+
+std::string PhaseLabel(GameState::Phase phase) {
+  switch (phase) {
+    case GameState::Phase::Attack:
+      return "Attack";
+    case GameState::Phase::Defend:
+      return "Defend";
+    case GameState::Phase::BonusReceive:
+      return "BonusReceive";
+    case GameState::Phase::Finished:
+      return "Finished";
+  }
+  return "Unknown";
+}
+
+std::string BuildStateMessage(const std::string& room_id, int turn, const MatchState& match, int seat) {
+  const GameState& round = match.round;
+  std::string hand;
+  if (seat >= 0) {
+    hand = JoinLabels(HandTiles(round.hands[seat]));
+  }
+
+  std::string legal;
+  if (seat >= 0 && seat == round.current_player && !round.finished) {
+    std::set<std::string> choices;
+    ActionList actions;
+    GenerateLegalActions(round, &actions);
+    for (const auto& action : actions) {
+      if (action.type == Action::Type::Pass) {
+        choices.insert("pass");
+        continue;
+      }
+      choices.insert(ToLabel(action.tile));
+    }
+    legal = JoinSet(choices);
+  }
+
+  std::string attack_tile;
+  if (round.attack_tile.has_value()) {
+    attack_tile = ToLabel(round.attack_tile->kind);
+  }
+
+  std::vector<int> hand_sizes;
+  for (int player = 0; player < round.players; ++player) {
+    hand_sizes.push_back(round.hands[player].Size());
+  }
+  const std::vector<int> bonus_discards(round.bonus_discards.begin(), round.bonus_discards.begin() + round.players);
+  const std::vector<int> scores(match.scores.begin(), match.scores.begin() + round.players);
+
+  std::ostringstream out;
+  out << "{\"type\":\"state\",\"room_id\":\"" << room_id << "\",";
+  out << "\"turn\":" << turn << ",";
+  out << "\"phase\":\"" << PhaseLabel(round.phase) << "\",";
+  out << "\"current_player\":" << round.current_player << ",";
+  out << "\"attack_tile\":\"" << attack_tile << "\",";
+  out << "\"hand\":\"" << hand << "\",";
+  out << "\"hand_sizes\":\"" << JoinInts(hand_sizes) << "\",";
+  out << "\"bonus_discards\":\"" << JoinInts(bonus_discards) << "\",";
+  out << "\"legal\":\"" << legal << "\",";
+  out << "\"scores\":\"" << JoinInts(scores) << "\"}";
+  return out.str();
+}
+
+std::string BuildRoundResultMessage(const RoundResult& result, const MatchState& match,
+                                    const std::vector<DiscardRecord>& winner_discards) {
+  const int winner = result.winner;
+  const GameState& final_state = result.final_state;
+  const std::vector<int> scores(match.scores.begin(), match.scores.begin() + final_state.players);
+
+  std::ostringstream out;
+  out << "{\"type\":\"round_result\",\"winner\":" << winner << ",";
+  out << "\"last_tile\":\"" << ToLabel(result.last_tile) << "\",";
+  out << "\"bonus_discards\":" << result.bonus_discards << ",";
+  out << "\"round_points\":" << result.points << ",";
+  out << "\"winner_hand\":\"" << JoinLabels(HandTiles(final_state.hands[winner])) << "\",";
+  out << "\"winner_hand_size\":" << final_state.hands[winner].Size() << ",";
+  out << "\"winner_discards\":\"" << JoinDiscards(winner_discards) << "\",";
+  out << "\"scores\":\"" << JoinInts(scores) << "\",";
+  out << "\"round\":" << match.round_index << "}";
+  return out.str();
+}
+
+std::string BuildGameOverMessage(const MatchState& match) {
+  const std::vector<int> scores(match.scores.begin(), match.scores.begin() + match.config.players);
+  std::ostringstream out;
+  out << "{\"type\":\"game_over\",\"winner\":" << match.winner << ",";
+  out << "\"scores\":\"" << JoinInts(scores) << "\"}";
+  return out.str();
+}
+
+std::string FormatScoreRules(const ScoreTable& table) {
+  std::ostringstream out;
+  for (int kind = 0; kind < kTileKinds; ++kind) {
+    if (kind > 0) {
+      out << ";";
+    }
+    out << ToLabel(static_cast<TileKind>(kind)) << ":" << table[kind].base;
+    if (table[kind].add_bonus) {
+      out << "+bonus";
+    }
+  }
+  return out.str();
+}
+
+bool ParseScoreRulesLine(const std::string& line, ScoreTable* table) {
+  std::string text = line;
+  std::replace(text.begin(), text.end(), ';', '\n');
+  return ParseScoreTable(text, table);
+}
+
+bool IsPassChoice(const std::string& token) {
+  std::string lower;
+  lower.reserve(token.size());
+  for (char c : token) {
+    lower.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+  }
+  return lower == "pass";
+}
+
+std::optional<Action> ParseChoice(const GameState& state, const std::string& choice) {
+  const std::string token = Trim(choice);
+  ActionList actions;
+  GenerateLegalActions(state, &actions);
+  if (IsPassChoice(token)) {
+    for (const auto& action : actions) {
+      if (action.type == Action::Type::Pass) {
+        return action;
+      }
+    }
+    return std::nullopt;
+  }
+  const auto kind = ParseLabel(token);
+  if (!kind.has_value()) {
+    return std::nullopt;
+  }
+  for (const auto& action : actions) {
+    if (action.type != Action::Type::Pass && action.tile == kind.value()) {
+      return action;
+    }
+  }
+  return std::nullopt;
+}
+
+}  // namespace tigerdragon::protocol
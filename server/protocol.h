@@ -0,0 +1,58 @@
+#pragma once
+
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "engine.h"
+
+// JSON message helpers for the WebSocket protocol (docs/protocol_ws_json.md).
+// Kept free of websocketpp so tools can encode and decode messages offline.
+namespace tigerdragon::protocol {
+
+struct DiscardRecord {
+  TileKind kind;
+  Action::Type type;
+};
+
+std::string Trim(const std::string& input);
+
+std::optional<std::string> ExtractString(const std::string& json, const std::string& key);
+std::optional<int> ExtractInt(const std::string& json, const std::string& key);
+
+std::string ToLabel(TileKind kind);
+std::optional<TileKind> ParseLabel(const std::string& token);
+std::string PhaseLabel(GameState::Phase phase);
+
+std::string JoinInts(const std::vector<int>& values);
+std::string JoinLabels(const std::vector<Tile>& tiles);
+std::string JoinSet(const std::set<std::string>& values);
+// Own discards with type suffixes ("5A,3D").
+std::string JoinDiscards(const std::vector<DiscardRecord>& records);
+// As JoinDiscards, but face-down bonus discards show as "B".
+std::string JoinPublicDiscards(const std::vector<DiscardRecord>& records);
+
+// The "state" message for `seat` (-1 for spectators, who get no hand or
+// legal moves).
+std::string BuildStateMessage(const std::string& room_id, int turn, const MatchState& match, int seat);
+
+// The "round_result" message for a round that `match` has just scored.
+// `winner_discards` are the winner's plays this round, in order.
+std::string BuildRoundResultMessage(const RoundResult& result, const MatchState& match,
+                                    const std::vector<DiscardRecord>& winner_discards);
+
+std::string BuildGameOverMessage(const MatchState& match);
+
+// Score rules on one line ("1:10;2:2+bonus;..."), for logs.
+std::string FormatScoreRules(const ScoreTable& table);
+bool ParseScoreRulesLine(const std::string& line, ScoreTable* table);
+
+// "pass" in any letter case.
+bool IsPassChoice(const std::string& token);
+
+// Resolves an action message's "choice" ("pass" or a tile label) against
+// the legal moves of `state`.
+std::optional<Action> ParseChoice(const GameState& state, const std::string& choice);
+
+}  // namespace tigerdragon::protocol
@@ -0,0 +1,103 @@
+#include "match_log.h"
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct VerifierOptions {
+  int threads = 0;
+  std::vector<std::string> inputs;
+};
+
+bool ParseOptions(int argc, char** argv, VerifierOptions* options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--threads") {
+      if (i + 1 >= argc) {
+        return false;
+      }
+      options->threads = std::atoi(argv[++i]);
+    } else {
+      options->inputs.push_back(arg);
+    }
+  }
+  return !options->inputs.empty();
+}
+
+// Directories expand to their *.log files, sorted so reports are stable.
+std::vector<std::string> CollectLogs(const std::vector<std::string>& inputs) {
+  std::vector<std::string> paths;
+  for (const auto& input : inputs) {
+    std::error_code error;
+    if (!std::filesystem::is_directory(input, error)) {
+      paths.push_back(input);
+      continue;
+    }
+    std::vector<std::string> found;
+    for (const auto& entry : std::filesystem::directory_iterator(input, error)) {
+      if (entry.is_regular_file() && entry.path().extension() == ".log") {
+        found.push_back(entry.path().string());
+      }
+    }
+    std::sort(found.begin(), found.end());
+    paths.insert(paths.end(), found.begin(), found.end());
+  }
+  return paths;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  VerifierOptions options;
+  if (!ParseOptions(argc, argv, &options)) {
+    std::cerr << "Usage: replay_verifier [--threads N] LOG_OR_DIR...\n";
+    return 1;
+  }
+
+  const std::vector<std::string> paths = CollectLogs(options.inputs);
+  std::vector<tigerdragon::protocol::MatchReplayResult> results(paths.size());
+  tigerdragon::WorkStealingPool pool(options.threads);
+
+  const auto start = std::chrono::steady_clock::now();
+  pool.ParallelFor(static_cast<int64_t>(paths.size()), [&](int64_t index, int) {
+    std::ifstream file(paths[index], std::ios::binary);
+    if (!file.is_open()) {
+      results[index].ok = false;
+      results[index].error = "cannot open";
+      return;
+    }
+    std::ostringstream text;
+    text << file.rdbuf();
+    results[index] = tigerdragon::protocol::VerifyMatchLog(text.str());
+  });
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  int64_t failed = 0;
+  int64_t plies = 0;
+  for (size_t i = 0; i < paths.size(); ++i) {
+    const auto& result = results[i];
+    plies += result.plies;
+    if (result.ok) {
+      continue;
+    }
+    ++failed;
+    std::cout << paths[i] << ":" << result.line << ": round " << result.round << " turn " << result.turn
+              << ": " << result.error << "\n";
+  }
+
+  std::cout << "Summary: matches=" << paths.size() << " ok=" << paths.size() - failed << " failed=" << failed
+            << " plies=" << plies << "\n";
+  std::cerr << "threads=" << pool.threads() << " seconds=" << seconds
+            << " matches/sec=" << (seconds > 0 ? paths.size() / seconds : 0.0) << "\n";
+  return failed > 0 ? 1 : 0;
+}
@@ -1,28 +1,36 @@
 #include "engine.h"
+#include "match_log.h"
+#include "protocol.h"
 
 #include <websocketpp/config/asio_no_tls.hpp>
 #include <websocketpp/server.hpp>
 
-#include <algorithm>
-#include <array>
-#include <cctype>
+#include <ctime>
 #include <filesystem>
 #include <fstream>
 #include <functional>
 #include <iostream>
 #include <map>
 #include <optional>
-#include <set>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
 using tigerdragon::Action;
-using tigerdragon::GameConfig;
 using tigerdragon::GameState;
-using tigerdragon::Tile;
 using tigerdragon::TileKind;
+using tigerdragon::protocol::BuildGameOverMessage;
+using tigerdragon::protocol::BuildRoundResultMessage;
+using tigerdragon::protocol::BuildStateMessage;
+using tigerdragon::protocol::DiscardRecord;
+using tigerdragon::protocol::ExtractString;
+using tigerdragon::protocol::IsPassChoice;
+using tigerdragon::protocol::JoinPublicDiscards;
+using tigerdragon::protocol::MatchLogWriter;
+using tigerdragon::protocol::ParseChoice;
+using tigerdragon::protocol::ParseLabel;
+using tigerdragon::protocol::Trim;
 
 namespace {
 
@@ -35,226 +43,6 @@ struct ClientInfo {
   bool spectator = false;
 };
 
-struct ScoreEntry {
-  int base = 0;
-  bool add_bonus = false;
-  bool set = false;
-};
-
-struct DiscardRecord {
-  TileKind kind;
-  Action::Type type;
-};
-
-constexpr size_t kTileKinds = static_cast<size_t>(TileKind::Dragon) + 1;
-
-std::string Trim(const std::string& input) {
-  size_t start = 0;
-  while (start < input.size() && std::isspace(static_cast<unsigned char>(input[start]))) {
-    ++start;
-  }
-  size_t end = input.size();
-  while (end > start && std::isspace(static_cast<unsigned char>(input[end - 1]))) {
-    --end;
-  }
-  return input.substr(start, end - start);
-}
-
-std::vector<std::string> SplitTokens(const std::string& input, char delim) {
-  std::vector<std::string> tokens;
-  std::string item;
-  std::stringstream ss(input);
-  while (std::getline(ss, item, delim)) {
-    std::string trimmed = Trim(item);
-    if (!trimmed.empty()) {
-      tokens.push_back(trimmed);
-    }
-  }
-  return tokens;
-}
-
-std::optional<std::string> ExtractString(const std::string& json, const std::string& key) {
-  std::string pattern = "\"" + key + "\"";
-  size_t pos = json.find(pattern);
-  if (pos == std::string::npos) {
-    return std::nullopt;
-  }
-  pos = json.find(':', pos + pattern.size());
-  if (pos == std::string::npos) {
-    return std::nullopt;
-  }
-  ++pos;
-  while (pos < json.size() && std::isspace(static_cast<unsigned char>(json[pos]))) {
-    ++pos;
-  }
-  if (pos >= json.size() || json[pos] != '"') {
-    return std::nullopt;
-  }
-  ++pos;
-  size_t end = json.find('"', pos);
-  if (end == std::string::npos) {
-    return std::nullopt;
-  }
-  return json.substr(pos, end - pos);
-}
-
-std::optional<int> ExtractInt(const std::string& json, const std::string& key) {
-  std::string pattern = "\"" + key + "\"";
-  size_t pos = json.find(pattern);
-  if (pos == std::string::npos) {
-    return std::nullopt;
-  }
-  pos = json.find(':', pos + pattern.size());
-  if (pos == std::string::npos) {
-    return std::nullopt;
-  }
-  ++pos;
-  while (pos < json.size() && std::isspace(static_cast<unsigned char>(json[pos]))) {
-    ++pos;
-  }
-  size_t end = pos;
-  while (end < json.size() && (std::isdigit(static_cast<unsigned char>(json[end])) || json[end] == '-')) {
-    ++end;
-  }
-  if (end == pos) {
-    return std::nullopt;
-  }
-  return std::stoi(json.substr(pos, end - pos));
-}
-
-std::string ToLabel(TileKind kind) {
-  switch (kind) {
-    case TileKind::Num1:
-      return "1";
-    case TileKind::Num2:
-      return "2";
-    case TileKind::Num3:
-      return "3";
-    case TileKind::Num4:
-      return "4";
-    case TileKind::Num5:
-      return "5";
-    case TileKind::Num6:
-      return "6";
-    case TileKind::Num7:
-      return "7";
-    case TileKind::Num8:
-      return "8";
-    case TileKind::Tiger:
-      return "T";
-    case TileKind::Dragon:
-      return "D";
-  }
-  return "?";
-}
-
-std::optional<TileKind> ParseLabel(const std::string& token) {
-  if (token == "1") return TileKind::Num1;
-  if (token == "2") return TileKind::Num2;
-  if (token == "3") return TileKind::Num3;
-  if (token == "4") return TileKind::Num4;
-  if (token == "5") return TileKind::Num5;
-  if (token == "6") return TileKind::Num6;
-  if (token == "7") return TileKind::Num7;
-  if (token == "8") return TileKind::Num8;
-  if (token == "T" || token == "t") return TileKind::Tiger;
-  if (token == "D" || token == "d") return TileKind::Dragon;
-  return std::nullopt;
-}
-
-std::string JoinInts(const std::vector<int>& values) {
-  std::ostringstream out;
-  for (size_t i = 0; i < values.size(); ++i) {
-    if (i > 0) {
-      out << ",";
-    }
-    out << values[i];
-  }
-  return out.str();
-}
-
-std::string JoinLabels(const std::vector<Tile>& tiles) {
-  std::ostringstream out;
-  for (size_t i = 0; i < tiles.size(); ++i) {
-    if (i > 0) {
-      out << ",";
-    }
-    out << ToLabel(tiles[i].kind);
-  }
-  return out.str();
-}
-
-char SuffixForAction(Action::Type type) {
-  switch (type) {
-    case Action::Type::Attack:
-      return 'A';
-    case Action::Type::Defend:
-      return 'D';
-    case Action::Type::BonusReceive:
-      return 'B';
-    case Action::Type::Pass:
-      break;
-  }
-  return '?';
-}
-
-std::string JoinDiscards(const std::vector<DiscardRecord>& records) {
-  std::ostringstream out;
-  size_t count = 0;
-  for (const auto& record : records) {
-    if (count > 0) {
-      out << ",";
-    }
-    out << ToLabel(record.kind) << SuffixForAction(record.type);
-    ++count;
-  }
-  return out.str();
-}
-
-std::string JoinSet(const std::set<std::string>& values) {
-  std::ostringstream out;
-  size_t i = 0;
-  for (const auto& value : values) {
-    if (i > 0) {
-      out << ",";
-    }
-    out << value;
-    ++i;
-  }
-  return out.str();
-}
-
-std::string JoinPublicDiscards(const std::vector<DiscardRecord>& records) {
-  std::ostringstream out;
-  size_t count = 0;
-  for (const auto& record : records) {
-    if (count > 0) {
-      out << ",";
-    }
-    if (record.type == Action::Type::BonusReceive) {
-      out << "B";
-    } else {
-      out << ToLabel(record.kind) << SuffixForAction(record.type);
-    }
-    ++count;
-  }
-  return out.str();
-}
-
-std::string PhaseLabel(GameState::Phase phase) {
-  switch (phase) {
-    case GameState::Phase::Attack:
-      return "Attack";
-    case GameState::Phase::Defend:
-      return "Defend";
-    case GameState::Phase::BonusReceive:
-      return "BonusReceive";
-    case GameState::Phase::Finished:
-      return "Finished";
-  }
-  return "Unknown";
-}
-
 std::string SpectatorUrl(uint16_t port, const std::string& room_id) {
   std::string path = "clients/web/spectator.html";
   try {
@@ -267,71 +55,26 @@ std::string SpectatorUrl(uint16_t port, const std::string& room_id) {
   return out.str();
 }
 
-bool ParseScoreRules(const std::string& path, std::array<ScoreEntry, kTileKinds>* table) {
+bool LoadScoreRules(const std::string& path, tigerdragon::ScoreTable* table) {
   std::ifstream file(path);
   if (!file.is_open()) {
     return false;
   }
-  std::string line;
-  while (std::getline(file, line)) {
-    size_t comment = line.find('#');
-    if (comment != std::string::npos) {
-      line = line.substr(0, comment);
-    }
-    line = Trim(line);
-    if (line.empty()) {
-      continue;
-    }
-    size_t colon = line.find(':');
-    if (colon == std::string::npos) {
-      return false;
-    }
-    std::string left = Trim(line.substr(0, colon));
-    std::string right = Trim(line.substr(colon + 1));
-    bool add_bonus = false;
-    std::string base_str = right;
-    size_t bonus_pos = right.find("+bonus");
-    if (bonus_pos != std::string::npos) {
-      add_bonus = true;
-      base_str = Trim(right.substr(0, bonus_pos));
-    }
-    int base = 0;
-    try {
-      base = std::stoi(base_str);
-    } catch (const std::exception&) {
-      return false;
-    }
-    auto tokens = SplitTokens(left, ',');
-    if (tokens.empty()) {
-      return false;
-    }
-    for (const auto& token : tokens) {
-      auto kind = ParseLabel(token);
-      if (!kind.has_value()) {
-        return false;
-      }
-      ScoreEntry& entry = (*table)[static_cast<size_t>(kind.value())];
-      entry.base = base;
-      entry.add_bonus = add_bonus;
-      entry.set = true;
-    }
-  }
-  for (const auto& entry : *table) {
-    if (!entry.set) {
-      return false;
-    }
-  }
-  return true;
+  std::ostringstream text;
+  text << file.rdbuf();
+  return tigerdragon::ParseScoreTable(text.str(), table);
 }
 
 class MatchServer {
  public:
-  MatchServer(int players, uint32_t seed, uint16_t port, const std::string& score_rules_path)
-      : players_(players), seed_(seed), port_(port), score_rules_path_(score_rules_path) {
-    if (!ParseScoreRules(score_rules_path_, &score_table_)) {
+  MatchServer(int players, uint32_t seed, uint16_t port, const std::string& score_rules_path,
+              const std::string& log_dir)
+      : players_(players), port_(port), score_rules_path_(score_rules_path), log_dir_(log_dir) {
+    match_config_.players = players_;
+    match_config_.seed = seed;
+    if (!LoadScoreRules(score_rules_path_, &match_config_.score_table)) {
       throw std::runtime_error("Failed to load score rules: " + score_rules_path_);
     }
-    scores_.assign(players_, 0);
     server_.init_asio();
     server_.set_reuse_addr(true);
     server_.set_open_handler([this](ConnectionHdl hdl) { OnOpen(hdl); });
@@ -425,7 +168,7 @@ class MatchServer {
       SendError(hdl, "game not started");
       return;
     }
-    if (match_over_) {
+    if (match_.finished) {
       SendError(hdl, "match over");
       return;
     }
@@ -438,7 +181,7 @@ class MatchServer {
       SendError(hdl, "spectator cannot act");
       return;
     }
-    if (info.seat != state_.current_player) {
+    if (info.seat != match_.round.current_player) {
       SendError(hdl, "not your turn");
       return;
     }
@@ -448,71 +191,32 @@ class MatchServer {
       return;
     }
 
-    std::string token = Trim(choice.value());
-    std::string lower;
-    lower.reserve(token.size());
-    for (char c : token) {
-      lower.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
-    }
-
-    auto actions = tigerdragon::GenerateLegalActions(state_);
-    std::optional<Action> selected;
-    if (lower == "pass") {
-      for (const auto& action : actions) {
-        if (action.type == Action::Type::Pass) {
-          selected = action;
-          break;
-        }
-      }
-    } else {
-      auto kind = ParseLabel(token);
-      if (!kind.has_value()) {
-        SendError(hdl, "invalid choice");
-        return;
-      }
-      Action::Type desired = Action::Type::Attack;
-      if (state_.phase == GameState::Phase::Defend) {
-        desired = Action::Type::Defend;
-      } else if (state_.phase == GameState::Phase::BonusReceive) {
-        desired = Action::Type::BonusReceive;
-      }
-      for (const auto& action : actions) {
-        if (action.type != desired || action.hand_index < 0 ||
-            action.hand_index >= static_cast<int>(state_.hands[action.player].size())) {
-          continue;
-        }
-        if (state_.hands[action.player][action.hand_index].kind == kind.value()) {
-          selected = action;
-          break;
-        }
-      }
+    const std::string token = Trim(choice.value());
+    if (!IsPassChoice(token) && !ParseLabel(token).has_value()) {
+      SendError(hdl, "invalid choice");
+      return;
     }
-
+    const std::optional<Action> selected = ParseChoice(match_.round, token);
     if (!selected.has_value()) {
       SendError(hdl, "illegal action");
       return;
     }
 
-    last_action_tile_.reset();
-    if (selected->hand_index >= 0 &&
-        selected->hand_index < static_cast<int>(state_.hands[selected->player].size())) {
-      TileKind kind = state_.hands[selected->player][selected->hand_index].kind;
-      last_action_tile_ = kind;
-      if (selected->type != Action::Type::Pass &&
-          selected->player >= 0 &&
-          selected->player < static_cast<int>(discards_.size())) {
-        discards_[selected->player].push_back(DiscardRecord{kind, selected->type});
-      }
+    if (selected->type != Action::Type::Pass && selected->player >= 0 &&
+        selected->player < static_cast<int>(discards_.size())) {
+      discards_[selected->player].push_back(DiscardRecord{selected->tile, selected->type});
     }
 
-    if (!tigerdragon::ApplyAction(state_, selected.value())) {
+    tigerdragon::RoundResult result;
+    if (!tigerdragon::ApplyMatchAction(match_, selected.value(), &result)) {
       SendError(hdl, "apply failed");
       return;
     }
 
+    match_log_.Write("choice", info.seat, token);
     ++turn_id_;
-    if (state_.hands[selected->player].empty()) {
-      FinishRound(selected->player);
+    if (result.winner >= 0) {
+      FinishRound(result);
       return;
     }
     BroadcastState();
@@ -532,71 +236,47 @@ class MatchServer {
   }
 
   void StartGame() {
-    GameConfig config;
-    config.players = players_;
-    config.seed = seed_;
-    state_ = tigerdragon::CreateInitialState(config);
+    match_ = tigerdragon::CreateMatch(match_config_);
     game_started_ = true;
+    ResetRoundLog();
+    if (!log_dir_.empty()) {
+      const std::string path = log_dir_ + "/match_" + std::to_string(match_config_.seed) + "_" +
+                               std::to_string(std::time(nullptr)) + ".log";
+      if (match_log_.Open(path, match_config_, room_id_)) {
+        std::cout << "Match log: " << path << "\n";
+      } else {
+        std::cerr << "Failed to open match log: " << path << "\n";
+      }
+    }
+  }
+
+  void ResetRoundLog() {
     turn_id_ = 0;
-    last_action_tile_.reset();
     discards_.assign(players_, {});
   }
 
   void BroadcastState() {
+    if (match_log_.is_open()) {
+      for (int seat = -1; seat < players_; ++seat) {
+        match_log_.Write("state", seat, BuildStateMessage(room_id_, turn_id_, match_, seat));
+      }
+    }
     for (const auto& entry : clients_) {
       SendState(entry.first, entry.second);
     }
   }
 
-  void BroadcastGameOver(int winner) {
-    std::ostringstream out;
-    out << "{\"type\":\"game_over\",\"winner\":" << winner << ",";
-    out << "\"scores\":\"" << JoinInts(scores_) << "\"}";
+  void BroadcastGameOver() {
+    const std::string message = BuildGameOverMessage(match_);
+    match_log_.Write("game_over", message);
     for (const auto& entry : clients_) {
-      server_.send(entry.first, out.str(), websocketpp::frame::opcode::text);
+      server_.send(entry.first, message, websocketpp::frame::opcode::text);
     }
   }
 
   void SendState(ConnectionHdl hdl, const ClientInfo& info) {
-    std::string hand;
-    if (!info.spectator && info.seat >= 0) {
-      hand = JoinLabels(state_.hands[info.seat]);
-    }
-
-    std::string legal;
-    if (!info.spectator && info.seat == state_.current_player && !state_.finished) {
-      std::set<std::string> choices;
-      auto actions = tigerdragon::GenerateLegalActions(state_);
-      for (const auto& action : actions) {
-        if (action.type == Action::Type::Pass) {
-          choices.insert("pass");
-          continue;
-        }
-        if (action.hand_index >= 0 && action.hand_index < static_cast<int>(state_.hands[action.player].size())) {
-          choices.insert(ToLabel(state_.hands[action.player][action.hand_index].kind));
-        }
-      }
-      legal = JoinSet(choices);
-    }
-
-    std::string attack_tile;
-    if (state_.attack_tile.has_value()) {
-      attack_tile = ToLabel(state_.attack_tile->kind);
-    }
-
-    std::ostringstream out;
-    out << "{\"type\":\"state\",\"room_id\":\"" << room_id_ << "\",";
-    out << "\"turn\":" << turn_id_ << ",";
-    out << "\"phase\":\"" << PhaseLabel(state_.phase) << "\",";
-    out << "\"current_player\":" << state_.current_player << ",";
-    out << "\"attack_tile\":\"" << attack_tile << "\",";
-    out << "\"hand\":\"" << hand << "\",";
-    out << "\"hand_sizes\":\"" << JoinInts(HandSizes()) << "\",";
-    out << "\"bonus_discards\":\"" << JoinInts(state_.bonus_discards) << "\",";
-    out << "\"legal\":\"" << legal << "\",";
-    out << "\"scores\":\"" << JoinInts(scores_) << "\"}";
-
-    server_.send(hdl, out.str(), websocketpp::frame::opcode::text);
+    const int seat = info.spectator ? -1 : info.seat;
+    server_.send(hdl, BuildStateMessage(room_id_, turn_id_, match_, seat), websocketpp::frame::opcode::text);
   }
 
   void SendDiscards(ConnectionHdl hdl) {
@@ -613,80 +293,28 @@ class MatchServer {
     server_.send(hdl, out.str(), websocketpp::frame::opcode::text);
   }
 
-  std::vector<int> HandSizes() const {
-    std::vector<int> sizes;
-    sizes.reserve(state_.hands.size());
-    for (const auto& hand : state_.hands) {
-      sizes.push_back(static_cast<int>(hand.size()));
-    }
-    return sizes;
-  }
-
   void SendError(ConnectionHdl hdl, const std::string& message) {
     std::ostringstream out;
     out << "{\"type\":\"error\",\"message\":\"" << message << "\"}";
     server_.send(hdl, out.str(), websocketpp::frame::opcode::text);
   }
 
-  int ScoreForTile(TileKind kind, int bonus_discards) const {
-    const ScoreEntry& entry = score_table_[static_cast<size_t>(kind)];
-    if (!entry.set) {
-      return 0;
-    }
-    int total = entry.base;
-    if (entry.add_bonus) {
-      total += bonus_discards;
-    }
-    return total;
-  }
-
-  void FinishRound(int winner) {
-    state_.finished = true;
-    state_.winner = winner;
-    state_.phase = GameState::Phase::Finished;
-
-    int bonus = 0;
-    std::string winner_hand;
-    std::string winner_discards;
-    int winner_hand_size = 0;
-    if (winner >= 0 && winner < static_cast<int>(state_.bonus_discards.size())) {
-      bonus = state_.bonus_discards[winner];
-      winner_hand = JoinLabels(state_.hands[winner]);
-      winner_hand_size = static_cast<int>(state_.hands[winner].size());
-      if (winner < static_cast<int>(discards_.size())) {
-        winner_discards = JoinDiscards(discards_[winner]);
-      }
-    }
-    int round_points = 0;
-    std::string last_tile;
-    if (last_action_tile_.has_value()) {
-      last_tile = ToLabel(last_action_tile_.value());
-      round_points = ScoreForTile(last_action_tile_.value(), bonus);
-    }
-    scores_[winner] += round_points;
-    ++round_index_;
-
-    std::ostringstream out;
-    out << "{\"type\":\"round_result\",\"winner\":" << winner << ",";
-    out << "\"last_tile\":\"" << last_tile << "\",";
-    out << "\"bonus_discards\":" << bonus << ",";
-    out << "\"round_points\":" << round_points << ",";
-    out << "\"winner_hand\":\"" << winner_hand << "\",";
-    out << "\"winner_hand_size\":" << winner_hand_size << ",";
-    out << "\"winner_discards\":\"" << winner_discards << "\",";
-    out << "\"scores\":\"" << JoinInts(scores_) << "\",";
-    out << "\"round\":" << round_index_ << "}";
+  void FinishRound(const tigerdragon::RoundResult& result) {
+    static const std::vector<DiscardRecord> kNoDiscards;
+    const int winner = result.winner;
+    const std::string message = BuildRoundResultMessage(
+        result, match_, winner < static_cast<int>(discards_.size()) ? discards_[winner] : kNoDiscards);
+    match_log_.Write("round_result", message);
     for (const auto& entry : clients_) {
-      server_.send(entry.first, out.str(), websocketpp::frame::opcode::text);
+      server_.send(entry.first, message, websocketpp::frame::opcode::text);
     }
 
-    if (scores_[winner] >= target_score_) {
-      match_over_ = true;
-      BroadcastGameOver(winner);
+    if (match_.finished) {
+      BroadcastGameOver();
       return;
     }
 
-    StartGame();
+    ResetRoundLog();
     BroadcastState();
   }
 
@@ -694,20 +322,17 @@ class MatchServer {
   std::map<ConnectionHdl, ClientInfo, std::owner_less<ConnectionHdl>> clients_;
   std::vector<ConnectionHdl> players_joined_;
   int players_ = 4;
-  uint32_t seed_ = 42;
   uint16_t port_ = 9002;
   std::string score_rules_path_;
+  // Match logs for replay_verifier go here when set.
+  std::string log_dir_;
+  MatchLogWriter match_log_;
   std::string room_id_ = "room1";
   bool game_started_ = false;
-  bool match_over_ = false;
   int turn_id_ = 0;
-  int round_index_ = 0;
-  int target_score_ = 10;
-  std::array<ScoreEntry, kTileKinds> score_table_{};
-  std::vector<int> scores_;
   std::vector<std::vector<DiscardRecord>> discards_;
-  std::optional<TileKind> last_action_tile_;
-  GameState state_;
+  tigerdragon::MatchConfig match_config_;
+  tigerdragon::MatchState match_;
 };
 
 }  // namespace
@@ -720,6 +345,10 @@ int main(int argc, char** argv) {
   if (argc > 1) {
     players = std::atoi(argv[1]);
   }
+  if (players < 2 || players > tigerdragon::kMaxPlayers) {
+    std::cerr << "players must be between 2 and " << tigerdragon::kMaxPlayers << "\n";
+    return 1;
+  }
   if (argc > 2) {
     seed = static_cast<uint32_t>(std::atoi(argv[2]));
   }
@@ -729,9 +358,13 @@ int main(int argc, char** argv) {
   if (argc > 4) {
     rules_path = argv[4];
   }
+  std::string log_dir;
+  if (argc > 5) {
+    log_dir = argv[5];
+  }
 
   try {
-    MatchServer server(players, seed, port, rules_path);
+    MatchServer server(players, seed, port, rules_path, log_dir);
     server.Run();
   } catch (const std::exception& ex) {
     std::cerr << ex.what() << "\n";
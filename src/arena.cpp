@@ -0,0 +1,521 @@
+#include "engine.h"
+#include "ismcts_player.h"
+#include "random_player.h"
+#include "rng.h"
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using tigerdragon::Action;
+using tigerdragon::GameState;
+
+namespace {
+
+// "random", "ismcts" or "ismcts:ITERATIONS[:SOLVER_TILES]".
+struct AgentSpec {
+  std::string name;
+  bool ismcts = false;
+  int64_t iterations = 1000;
+  int solver_tiles = 0;
+};
+
+struct ArenaOptions {
+  int players = 2;
+  std::vector<AgentSpec> agents;
+  // "round-robin" plays every pair; "gauntlet" plays agent 0 against each
+  // of the others.
+  std::string mode = "round-robin";
+  // Replay each deal under every seat assignment of the two agents, with
+  // agent RNG seeds keyed by seat, and score per deal.
+  bool duplicate = false;
+  // Units per pair: games, or deals in duplicate mode. SPRT may stop a pair
+  // earlier.
+  int64_t games = 1000;
+  // Units per pair between SPRT checks.
+  int64_t batch = 64;
+  int threads = 0;
+  uint64_t seed = 42;
+  int target_score = 10;
+  bool sprt = false;
+  double elo0 = 0.0;
+  double elo1 = 10.0;
+  double alpha = 0.05;
+  double beta = 0.05;
+};
+
+struct Pairing {
+  enum class Status { Running, AcceptH0, AcceptH1, Exhausted };
+
+  int a = 0;
+  int b = 0;
+  int64_t games = 0;
+  int64_t wins = 0;  // By agent a.
+  // Games an agent or the engine could not finish; their units are left
+  // out of every statistic.
+  int64_t failed = 0;
+  // A unit is one game, or one deal in duplicate mode; its score is agent
+  // a's share of the unit's wins.
+  int64_t next_unit = 0;
+  int64_t units = 0;
+  double score_sum = 0.0;
+  double score_squares = 0.0;
+  double llr = 0.0;
+
+  double MeanScore() const { return units > 0 ? score_sum / units : 0.0; }
+  double UnitVariance() const {
+    const double mean = MeanScore();
+    return units > 0 ? std::max(score_squares / units - mean * mean, 0.0) : 0.0;
+  }
+  Status status = Status::Running;
+};
+
+class ArenaAgent {
+ public:
+  ArenaAgent(const AgentSpec& spec, uint32_t seed) : random_(seed) {
+    if (spec.ismcts) {
+      tigerdragon::IsmctsConfig config;
+      config.max_iterations = spec.iterations;
+      config.solver_tiles = spec.solver_tiles;
+      config.trees = 1;
+      config.seed = seed;
+      ismcts_ = std::make_unique<tigerdragon::IsmctsPlayer>(config);
+    }
+  }
+
+  bool ChooseAction(const GameState& state, const tigerdragon::ActionList& actions, Action* out_action) {
+    if (ismcts_ != nullptr) {
+      return ismcts_->ChooseAction(state, actions, out_action);
+    }
+    return random_.ChooseAction(actions, out_action);
+  }
+
+ private:
+  tigerdragon::RandomPlayer random_;
+  std::unique_ptr<tigerdragon::IsmctsPlayer> ismcts_;
+};
+
+uint64_t GameKey(uint64_t seed, int pair, int64_t game) {
+  return tigerdragon::Mix64(seed + 0x9E3779B97F4A7C15ULL * ((static_cast<uint64_t>(pair) << 40) + game + 1));
+}
+
+// Per seat: 0 for agent a, 1 for agent b.
+using Assignment = std::array<uint8_t, tigerdragon::kMaxPlayers>;
+
+// Seats alternate between the two agents; the assignment rotates with the
+// game index.
+Assignment RotatingAssignment(int players, int64_t game) {
+  Assignment assignment{};
+  for (int seat = 0; seat < players; ++seat) {
+    assignment[seat] = static_cast<uint8_t>((seat + game) % 2);
+  }
+  return assignment;
+}
+
+// Every rotation of the alternating assignment and its mirror, without
+// repeats: 2 for even player counts, 2 * players for odd ones. Each agent
+// holds every seat equally often across the set.
+std::vector<Assignment> DuplicateAssignments(int players) {
+  std::vector<Assignment> assignments;
+  for (int swap = 0; swap < 2; ++swap) {
+    for (int rotation = 0; rotation < players; ++rotation) {
+      Assignment assignment{};
+      for (int seat = 0; seat < players; ++seat) {
+        assignment[seat] = static_cast<uint8_t>((seat + rotation) % players % 2 ^ swap);
+      }
+      if (std::find(assignments.begin(), assignments.end(), assignment) == assignments.end()) {
+        assignments.push_back(assignment);
+      }
+    }
+  }
+  return assignments;
+}
+
+enum class MatchOutcome { WinA, WinB, Failed };
+
+// One full match on the deals of `key`. Agent RNG seeds are keyed by seat,
+// so whichever agent holds a seat in a duplicate replay draws the same
+// random numbers there.
+MatchOutcome PlayMatch(const ArenaOptions& options, const Pairing& pairing, uint64_t key,
+                       int first_start_player, const Assignment& assignment) {
+  tigerdragon::MatchConfig config;
+  config.players = options.players;
+  config.seed = static_cast<uint32_t>(key);
+  config.first_start_player = first_start_player;
+  config.target_score = options.target_score;
+  tigerdragon::MatchState match = tigerdragon::CreateMatch(config);
+
+  std::vector<ArenaAgent> agents;
+  agents.reserve(options.players);
+  for (int seat = 0; seat < options.players; ++seat) {
+    agents.emplace_back(options.agents[assignment[seat] == 0 ? pairing.a : pairing.b],
+                        static_cast<uint32_t>(tigerdragon::Mix64(key + seat + 1)));
+  }
+
+  while (!match.finished) {
+    tigerdragon::ActionList actions;
+    Action action;
+    if (tigerdragon::GenerateLegalActions(match.round, &actions) == 0 ||
+        !agents[match.round.current_player].ChooseAction(match.round, actions, &action) ||
+        !tigerdragon::ApplyMatchAction(match, action, nullptr)) {
+      return MatchOutcome::Failed;
+    }
+  }
+  return assignment[match.winner] == 0 ? MatchOutcome::WinA : MatchOutcome::WinB;
+}
+
+struct UnitResult {
+  int games = 0;
+  int wins = 0;
+  int failed = 0;
+};
+
+UnitResult PlayUnit(const ArenaOptions& options, const std::vector<Assignment>& duplicate,
+                    const Pairing& pairing, int pair, int64_t unit) {
+  const uint64_t key = GameKey(options.seed, pair, unit);
+  const int first_start_player = static_cast<int>(unit % options.players);
+  UnitResult result;
+  auto play = [&](const Assignment& assignment) {
+    const MatchOutcome outcome = PlayMatch(options, pairing, key, first_start_player, assignment);
+    result.games += outcome != MatchOutcome::Failed;
+    result.wins += outcome == MatchOutcome::WinA;
+    result.failed += outcome == MatchOutcome::Failed;
+  };
+  if (!options.duplicate) {
+    play(RotatingAssignment(options.players, unit));
+    return result;
+  }
+  for (const Assignment& assignment : duplicate) {
+    play(assignment);
+  }
+  return result;
+}
+
+double ExpectedScore(double elo) { return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0)); }
+
+double EloFromScore(double score) { return -400.0 * std::log10(1.0 / score - 1.0); }
+
+// Score clamped away from 0 and 1 so a sweep still gives a finite Elo.
+double ClampedScore(double wins, double games) {
+  return std::clamp(wins / games, 0.5 / games, 1.0 - 0.5 / games);
+}
+
+// Log-likelihood ratio of H1 (elo1) against H0 (elo0) for a win/loss
+// record; games never draw.
+double SprtLlr(int64_t wins, int64_t losses, double elo0, double elo1) {
+  const double p0 = ExpectedScore(elo0);
+  const double p1 = ExpectedScore(elo1);
+  return wins * std::log(p1 / p0) + losses * std::log((1.0 - p1) / (1.0 - p0));
+}
+
+// Normal approximation of the same ratio for per-deal mean scores, whose
+// variance is estimated from the sample.
+double SprtLlrNormal(const Pairing& pairing, double elo0, double elo1) {
+  const double variance = pairing.UnitVariance();
+  if (pairing.units < 2 || variance <= 0.0) {
+    return 0.0;
+  }
+  const double p0 = ExpectedScore(elo0);
+  const double p1 = ExpectedScore(elo1);
+  return pairing.units * (p1 - p0) * (2.0 * pairing.MeanScore() - p0 - p1) / (2.0 * variance);
+}
+
+// Bradley-Terry ratings from all pairings (minorize-maximize), in Elo
+// relative to agent 0. Each pair gets half a win per side as a prior so
+// sweeps stay finite.
+std::vector<double> Ratings(int agents, const std::vector<Pairing>& pairings) {
+  std::vector<double> strength(agents, 1.0);
+  for (int iteration = 0; iteration < 1000; ++iteration) {
+    std::vector<double> next(agents, 0.0);
+    for (int agent = 0; agent < agents; ++agent) {
+      double wins = 0.0;
+      double denominator = 0.0;
+      for (const auto& pairing : pairings) {
+        if (pairing.a != agent && pairing.b != agent) {
+          continue;
+        }
+        const int other = pairing.a == agent ? pairing.b : pairing.a;
+        const int64_t won = pairing.a == agent ? pairing.wins : pairing.games - pairing.wins;
+        wins += won + 0.5;
+        denominator += (pairing.games + 1.0) / (strength[agent] + strength[other]);
+      }
+      next[agent] = denominator > 0.0 ? wins / denominator : strength[agent];
+    }
+    strength = next;
+  }
+  std::vector<double> elo(agents);
+  for (int agent = 0; agent < agents; ++agent) {
+    elo[agent] = 400.0 * std::log10(strength[agent] / strength[0]);
+  }
+  return elo;
+}
+
+const char* StatusLabel(Pairing::Status status) {
+  switch (status) {
+    case Pairing::Status::Running:
+      return "running";
+    case Pairing::Status::AcceptH0:
+      return "H0";
+    case Pairing::Status::AcceptH1:
+      return "H1";
+    case Pairing::Status::Exhausted:
+      return "max-games";
+  }
+  return "?";
+}
+
+bool ParseAgent(const std::string& text, AgentSpec* spec) {
+  spec->name = text;
+  std::stringstream parts(text);
+  std::string part;
+  std::getline(parts, part, ':');
+  if (part == "random") {
+    return parts.eof();
+  }
+  if (part != "ismcts") {
+    return false;
+  }
+  spec->ismcts = true;
+  if (std::getline(parts, part, ':')) {
+    spec->iterations = std::atoll(part.c_str());
+  }
+  if (std::getline(parts, part, ':')) {
+    spec->solver_tiles = std::atoi(part.c_str());
+  }
+  return spec->iterations > 0;
+}
+
+bool ParseOptions(int argc, char** argv, ArenaOptions* options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--duplicate") {
+      options->duplicate = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const char* value = argv[++i];
+    if (arg == "--agents") {
+      std::stringstream names(value);
+      std::string name;
+      while (std::getline(names, name, ',')) {
+        AgentSpec spec;
+        if (!ParseAgent(name, &spec)) {
+          return false;
+        }
+        options->agents.push_back(spec);
+      }
+    } else if (arg == "--mode") {
+      options->mode = value;
+    } else if (arg == "--players") {
+      options->players = std::atoi(value);
+    } else if (arg == "--games") {
+      options->games = std::atoll(value);
+    } else if (arg == "--batch") {
+      options->batch = std::atoll(value);
+    } else if (arg == "--threads") {
+      options->threads = std::atoi(value);
+    } else if (arg == "--seed") {
+      options->seed = std::strtoull(value, nullptr, 10);
+    } else if (arg == "--target-score") {
+      options->target_score = std::atoi(value);
+    } else if (arg == "--sprt") {
+      options->sprt = std::sscanf(value, "%lf,%lf", &options->elo0, &options->elo1) == 2;
+      if (!options->sprt) {
+        return false;
+      }
+    } else if (arg == "--alpha") {
+      options->alpha = std::atof(value);
+    } else if (arg == "--beta") {
+      options->beta = std::atof(value);
+    } else {
+      return false;
+    }
+  }
+  return options->agents.size() >= 2 && options->players >= 2 &&
+         options->players <= tigerdragon::kMaxPlayers && options->games > 0 && options->batch > 0 &&
+         (options->mode == "round-robin" || options->mode == "gauntlet") && options->elo1 > options->elo0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ArenaOptions options;
+  if (!ParseOptions(argc, argv, &options)) {
+    std::cerr << "Usage: arena --agents A,B[,...] [--mode round-robin|gauntlet] [--players 2-5]"
+                 " [--duplicate] [--games N] [--batch N] [--threads N] [--seed N] [--target-score N]"
+                 " [--sprt ELO0,ELO1] [--alpha A] [--beta B]\n"
+                 "  agents: random | ismcts[:ITERATIONS[:SOLVER_TILES]]\n";
+    return 1;
+  }
+
+  const int agent_count = static_cast<int>(options.agents.size());
+  std::vector<Pairing> pairings;
+  for (int a = 0; a < agent_count; ++a) {
+    for (int b = a + 1; b < agent_count; ++b) {
+      if (options.mode == "gauntlet" && a != 0) {
+        break;
+      }
+      pairings.push_back(Pairing{a, b});
+    }
+  }
+  const double upper = std::log((1.0 - options.beta) / options.alpha);
+  const double lower = std::log(options.beta / (1.0 - options.alpha));
+  const std::vector<Assignment> duplicate = DuplicateAssignments(options.players);
+
+  tigerdragon::WorkStealingPool pool(options.threads);
+  const auto start = std::chrono::steady_clock::now();
+  int64_t total_games = 0;
+  int64_t total_failed = 0;
+  // Batches are fixed per pair and SPRT is checked between them, so the
+  // stopping point does not depend on the thread count.
+  while (true) {
+    struct Job {
+      int pair;
+      int64_t unit;
+    };
+    std::vector<Job> jobs;
+    for (int pair = 0; pair < static_cast<int>(pairings.size()); ++pair) {
+      const Pairing& pairing = pairings[pair];
+      if (pairing.status != Pairing::Status::Running) {
+        continue;
+      }
+      const int64_t end = std::min(options.games, pairing.next_unit + options.batch);
+      for (int64_t unit = pairing.next_unit; unit < end; ++unit) {
+        jobs.push_back(Job{pair, unit});
+      }
+    }
+    if (jobs.empty()) {
+      break;
+    }
+    std::vector<UnitResult> results(jobs.size());
+    pool.ParallelFor(static_cast<int64_t>(jobs.size()), [&](int64_t index, int) {
+      const Job& job = jobs[index];
+      results[index] = PlayUnit(options, duplicate, pairings[job.pair], job.pair, job.unit);
+    });
+    for (size_t i = 0; i < jobs.size(); ++i) {
+      Pairing& pairing = pairings[jobs[i].pair];
+      ++pairing.next_unit;
+      total_games += results[i].games + results[i].failed;
+      if (results[i].failed > 0) {
+        // A deal missing some of its seatings is no longer balanced, so the
+        // whole unit is dropped.
+        pairing.failed += results[i].failed;
+        total_failed += results[i].failed;
+        continue;
+      }
+      const double score = static_cast<double>(results[i].wins) / results[i].games;
+      pairing.games += results[i].games;
+      pairing.wins += results[i].wins;
+      ++pairing.units;
+      pairing.score_sum += score;
+      pairing.score_squares += score * score;
+    }
+
+    for (auto& pairing : pairings) {
+      if (pairing.status != Pairing::Status::Running) {
+        continue;
+      }
+      if (options.sprt) {
+        pairing.llr = options.duplicate
+                          ? SprtLlrNormal(pairing, options.elo0, options.elo1)
+                          : SprtLlr(pairing.wins, pairing.games - pairing.wins, options.elo0, options.elo1);
+        if (pairing.llr >= upper) {
+          pairing.status = Pairing::Status::AcceptH1;
+        } else if (pairing.llr <= lower) {
+          pairing.status = Pairing::Status::AcceptH0;
+        }
+      }
+      if (pairing.status == Pairing::Status::Running && pairing.next_unit >= options.games) {
+        pairing.status = Pairing::Status::Exhausted;
+      }
+    }
+    std::cerr << "games=" << total_games << "\r" << std::flush;
+  }
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cerr << "\n";
+
+  std::printf("%-24s %-24s %8s %8s %7s %9s %19s %7s", "agent_a", "agent_b", "games", "wins_a", "score", "elo",
+              "95% ci", "failed");
+  if (options.sprt) {
+    std::printf(" %8s %9s", "llr", "sprt");
+  }
+  std::printf("\n");
+  for (const auto& pairing : pairings) {
+    if (pairing.units == 0) {
+      std::printf("%-24s %-24s %8d %8s %7s %9s %19s %7lld", options.agents[pairing.a].name.c_str(),
+                  options.agents[pairing.b].name.c_str(), 0, "-", "-", "-", "-",
+                  static_cast<long long>(pairing.failed));
+      if (options.sprt) {
+        std::printf(" %8s %9s", "-", StatusLabel(pairing.status));
+      }
+      std::printf("\n");
+      continue;
+    }
+    const double games = static_cast<double>(pairing.games);
+    const double score = ClampedScore(static_cast<double>(pairing.wins), games);
+    // Per-deal scores carry their own variance; single games are Bernoulli.
+    const double variance = options.duplicate ? pairing.UnitVariance() : score * (1.0 - score);
+    const double margin = 1.96 * std::sqrt(variance / pairing.units);
+    const double low = EloFromScore(std::max(score - margin, 0.5 / games));
+    const double high = EloFromScore(std::min(score + margin, 1.0 - 0.5 / games));
+    std::printf("%-24s %-24s %8lld %8lld %7.3f %+9.1f [%+8.1f,%+8.1f] %7lld",
+                options.agents[pairing.a].name.c_str(), options.agents[pairing.b].name.c_str(),
+                static_cast<long long>(pairing.games), static_cast<long long>(pairing.wins),
+                static_cast<double>(pairing.wins) / games, EloFromScore(score), low, high,
+                static_cast<long long>(pairing.failed));
+    if (options.sprt) {
+      std::printf(" %+8.3f %9s", pairing.llr, StatusLabel(pairing.status));
+    }
+    std::printf("\n");
+  }
+  if (options.duplicate) {
+    // Independent games would give the mean score a variance of
+    // p(1 - p) / games; the ratio to the per-deal estimate is the saving.
+    std::printf("\nDuplicate deals: %zu games per deal\n", duplicate.size());
+    std::printf("%-24s %-24s %8s %12s %12s %10s %12s\n", "agent_a", "agent_b", "deals", "var_dup", "var_indep",
+                "reduction", "equiv_games");
+    for (const auto& pairing : pairings) {
+      if (pairing.units == 0) {
+        continue;
+      }
+      const double score = pairing.MeanScore();
+      const double dup_variance = pairing.UnitVariance() / pairing.units;
+      const double independent_variance = score * (1.0 - score) / pairing.games;
+      const double reduction =
+          dup_variance > 0.0 ? independent_variance / dup_variance : std::numeric_limits<double>::infinity();
+      std::printf("%-24s %-24s %8lld %12.3e %12.3e %9.2fx %12.0f\n", options.agents[pairing.a].name.c_str(),
+                  options.agents[pairing.b].name.c_str(), static_cast<long long>(pairing.units), dup_variance,
+                  independent_variance, reduction, reduction * pairing.games);
+    }
+  }
+  if (options.sprt) {
+    std::printf("SPRT: elo0=%g elo1=%g alpha=%g beta=%g bounds=[%.3f, %.3f]\n", options.elo0, options.elo1,
+                options.alpha, options.beta, lower, upper);
+  }
+
+  const std::vector<double> ratings = Ratings(agent_count, pairings);
+  std::printf("\nRatings (Elo relative to %s)\n", options.agents[0].name.c_str());
+  for (int agent = 0; agent < agent_count; ++agent) {
+    std::printf("%-24s %+9.1f\n", options.agents[agent].name.c_str(), ratings[agent]);
+  }
+  std::cerr << "threads=" << pool.threads() << " seconds=" << seconds
+            << " games/sec=" << (seconds > 0 ? total_games / seconds : 0.0) << "\n";
+  if (total_failed > 0) {
+    std::cerr << "error: " << total_failed << " games failed and were excluded\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,257 @@
+#include "batch_engine.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace tigerdragon {
+
+namespace {
+
+constexpr int32_t kAttack = static_cast<int32_t>(GameState::Phase::Attack);
+constexpr int32_t kDefend = static_cast<int32_t>(GameState::Phase::Defend);
+constexpr int32_t kBonus = static_cast<int32_t>(GameState::Phase::BonusReceive);
+
+#ifdef __AVX2__
+// Defender masks indexed by attack tile; slot kTileKinds means no attack.
+alignas(32) const int64_t kDefendTable[kTileKinds + 1] = {
+    kDefendMasks[0], kDefendMasks[1], kDefendMasks[2], kDefendMasks[3],
+    kDefendMasks[4], kDefendMasks[5], kDefendMasks[6], kDefendMasks[7],
+    kDefendMasks[8], kDefendMasks[9], 0,
+};
+
+__m256i Load4(const int32_t* values) {
+  return _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values)));
+}
+
+void Store4(int32_t* values, __m256i lanes) {
+  const __m256i low_halves = _mm256_permutevar8x32_epi32(lanes, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(values), _mm256_castsi256_si128(low_halves));
+}
+
+__m256i Select(__m256i mask, __m256i if_true, __m256i if_false) {
+  return _mm256_blendv_epi8(if_false, if_true, mask);
+}
+#endif
+
+}  // namespace
+
+BatchEngine::BatchEngine(int games, int players, uint32_t seed)
+    : games_(games), players_(players), seed_(seed) {
+  if (games_ < 0 || players_ < 2 || players_ > kMaxPlayers) {
+    games_ = 0;
+    players_ = 0;
+  }
+  hands_.assign(static_cast<size_t>(kMaxPlayers) * games_, 0);
+  bonus_.assign(static_cast<size_t>(kMaxPlayers) * games_, 0);
+  phase_.assign(games_, kAttack);
+  current_.assign(games_, 0);
+  attack_player_.assign(games_, -1);
+  attack_tile_.assign(games_, kTileKinds);
+  deals_.assign(games_, 0);
+  for (int game = 0; game < games_; ++game) {
+    Reset(game);
+  }
+}
+
+void BatchEngine::Reset(int game) {
+  GameConfig config;
+  config.players = players_;
+  config.seed = seed_;
+  config.rng = GameConfig::Rng::Philox;
+  config.deal_index = static_cast<uint64_t>(game) << 32 | deals_[game]++;
+  const GameState state = CreateInitialState(config);
+  for (int player = 0; player < kMaxPlayers; ++player) {
+    hands_[player * games_ + game] = state.hands[player].counts;
+    bonus_[player * games_ + game] = 0;
+  }
+  phase_[game] = static_cast<int32_t>(state.phase);
+  current_[game] = state.current_player;
+  attack_player_[game] = state.attack_player;
+  attack_tile_[game] = kTileKinds;
+}
+
+GameState BatchEngine::ToGameState(int game) const {
+  GameState state;
+  state.players = players_;
+  state.phase = static_cast<GameState::Phase>(phase_[game]);
+  state.current_player = current_[game];
+  state.attack_player = attack_player_[game];
+  if (attack_tile_[game] < kTileKinds) {
+    state.attack_tile = Tile{static_cast<TileKind>(attack_tile_[game])};
+  }
+  for (int player = 0; player < players_; ++player) {
+    state.hands[player].counts = hands_[player * games_ + game];
+    state.bonus_discards[player] = bonus_[player * games_ + game];
+  }
+  state.hash = ComputeHash(state);
+  return state;
+}
+
+void BatchEngine::LegalMasks(uint16_t* out) const {
+  for (int game = 0; game < games_; ++game) {
+    Hand hand;
+    hand.counts = hands_[current_[game] * games_ + game];
+    uint16_t mask = hand.KindMask();
+    if (phase_[game] == kDefend) {
+      mask = static_cast<uint16_t>((mask & DefendMask(static_cast<TileKind>(attack_tile_[game]))) |
+                                   (1u << kPassCode));
+    }
+    out[game] = mask;
+  }
+}
+
+void BatchEngine::StepScalar(int game, uint8_t action, float* reward, uint8_t* done) {
+  *reward = 0.0f;
+  *done = 0;
+  const int player = current_[game];
+  uint64_t& hand = hands_[player * games_ + game];
+  const int next = player + 1 == players_ ? 0 : player + 1;
+
+  if (action == kPassCode) {
+    if (phase_[game] == kDefend) {
+      current_[game] = next;
+      if (next == attack_player_[game]) {
+        phase_[game] = kBonus;
+      }
+    }
+    return;
+  }
+  if (action >= kTileKinds || ((hand >> (4 * action)) & 0xF) == 0) {
+    return;
+  }
+  if (phase_[game] == kDefend &&
+      (DefendMask(static_cast<TileKind>(attack_tile_[game])) & (1u << action)) == 0) {
+    return;
+  }
+
+  hand -= uint64_t{1} << (4 * action);
+  if (phase_[game] == kAttack) {
+    attack_tile_[game] = action;
+    attack_player_[game] = player;
+    phase_[game] = kDefend;
+    current_[game] = next;
+  } else if (phase_[game] == kBonus) {
+    bonus_[player * games_ + game] += 1;
+    phase_[game] = kAttack;
+  } else {
+    attack_tile_[game] = kTileKinds;
+    attack_player_[game] = player;
+    phase_[game] = kAttack;
+  }
+  if (hand == 0) {
+    *reward = 1.0f;
+    *done = 1;
+  }
+}
+
+#ifdef __AVX2__
+void BatchEngine::StepBlockAvx2(int first, const uint8_t* actions, float* rewards,
+                                uint8_t* dones) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one = _mm256_set1_epi64x(1);
+  const __m256i nibble = _mm256_set1_epi64x(0xF);
+
+  uint32_t action_bytes;
+  __builtin_memcpy(&action_bytes, actions + first, sizeof(action_bytes));
+  const __m256i action = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(static_cast<int>(action_bytes)));
+  const __m256i phase = Load4(&phase_[first]);
+  const __m256i current = Load4(&current_[first]);
+  const __m256i attack_player = Load4(&attack_player_[first]);
+  const __m256i attack_tile = Load4(&attack_tile_[first]);
+
+  // Current player's hand, gathered by blending over the seats.
+  __m256i seat_masks[kMaxPlayers];
+  __m256i hand = zero;
+  for (int player = 0; player < players_; ++player) {
+    seat_masks[player] = _mm256_cmpeq_epi64(current, _mm256_set1_epi64x(player));
+    const __m256i seat_hand =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&hands_[player * games_ + first]));
+    hand = Select(seat_masks[player], seat_hand, hand);
+  }
+
+  const __m256i shift = _mm256_slli_epi64(action, 2);
+  const __m256i count = _mm256_and_si256(_mm256_srlv_epi64(hand, shift), nibble);
+  const __m256i is_pass = _mm256_cmpeq_epi64(action, _mm256_set1_epi64x(kPassCode));
+  const __m256i is_tile = _mm256_cmpgt_epi64(_mm256_set1_epi64x(kTileKinds), action);
+  const __m256i has_tile = _mm256_and_si256(is_tile, _mm256_cmpgt_epi64(count, zero));
+
+  const __m256i in_attack = _mm256_cmpeq_epi64(phase, _mm256_set1_epi64x(kAttack));
+  const __m256i in_defend = _mm256_cmpeq_epi64(phase, _mm256_set1_epi64x(kDefend));
+  const __m256i in_bonus = _mm256_cmpeq_epi64(phase, _mm256_set1_epi64x(kBonus));
+
+  const __m256i defenders = _mm256_i64gather_epi64(
+      reinterpret_cast<const long long*>(kDefendTable), attack_tile, 8);
+  const __m256i can_defend =
+      _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_srlv_epi64(defenders, action), one), one);
+
+  const __m256i do_attack = _mm256_and_si256(in_attack, has_tile);
+  const __m256i do_bonus = _mm256_and_si256(in_bonus, has_tile);
+  const __m256i do_defend = _mm256_and_si256(in_defend, _mm256_and_si256(has_tile, can_defend));
+  const __m256i do_pass = _mm256_and_si256(in_defend, is_pass);
+  const __m256i removes = _mm256_or_si256(do_attack, _mm256_or_si256(do_bonus, do_defend));
+
+  // Remove the played tile from the mover's hand.
+  const __m256i delta = _mm256_and_si256(_mm256_sllv_epi64(one, shift), removes);
+  const __m256i new_hand = _mm256_sub_epi64(hand, delta);
+  for (int player = 0; player < players_; ++player) {
+    __m256i* slot = reinterpret_cast<__m256i*>(&hands_[player * games_ + first]);
+    const __m256i seat_delta = _mm256_and_si256(delta, seat_masks[player]);
+    _mm256_storeu_si256(slot, _mm256_sub_epi64(_mm256_loadu_si256(slot), seat_delta));
+
+    int32_t* bonus = &bonus_[player * games_ + first];
+    // Masks are all-ones (-1), so subtracting them adds one bonus discard.
+    const __m256i seat_bonus = _mm256_and_si256(do_bonus, seat_masks[player]);
+    Store4(bonus, _mm256_sub_epi64(Load4(bonus), seat_bonus));
+  }
+
+  __m256i next = _mm256_add_epi64(current, one);
+  next = Select(_mm256_cmpeq_epi64(next, _mm256_set1_epi64x(players_)), zero, next);
+
+  const __m256i advances = _mm256_or_si256(do_attack, do_pass);
+  const __m256i new_current = Select(advances, next, current);
+
+  __m256i new_phase = phase;
+  new_phase = Select(do_attack, _mm256_set1_epi64x(kDefend), new_phase);
+  new_phase = Select(_mm256_or_si256(do_bonus, do_defend), _mm256_set1_epi64x(kAttack), new_phase);
+  new_phase = Select(_mm256_and_si256(do_pass, _mm256_cmpeq_epi64(next, attack_player)),
+                     _mm256_set1_epi64x(kBonus), new_phase);
+
+  const __m256i takes_lead = _mm256_or_si256(do_attack, do_defend);
+  const __m256i new_attack_player = Select(takes_lead, current, attack_player);
+  __m256i new_attack_tile = Select(do_attack, action, attack_tile);
+  new_attack_tile = Select(do_defend, _mm256_set1_epi64x(kTileKinds), new_attack_tile);
+
+  Store4(&phase_[first], new_phase);
+  Store4(&current_[first], new_current);
+  Store4(&attack_player_[first], new_attack_player);
+  Store4(&attack_tile_[first], new_attack_tile);
+
+  const __m256i finished = _mm256_and_si256(removes, _mm256_cmpeq_epi64(new_hand, zero));
+  const int finished_bits = _mm256_movemask_pd(_mm256_castsi256_pd(finished));
+  for (int lane = 0; lane < 4; ++lane) {
+    const bool done = (finished_bits >> lane) & 1;
+    rewards[first + lane] = done ? 1.0f : 0.0f;
+    dones[first + lane] = done ? 1 : 0;
+  }
+}
+#endif
+
+void BatchEngine::Step(const uint8_t* actions, float* rewards, uint8_t* dones) {
+  int game = 0;
+#ifdef __AVX2__
+  for (; game + 4 <= games_; game += 4) {
+    StepBlockAvx2(game, actions, rewards, dones);
+  }
+#endif
+  for (; game < games_; ++game) {
+    StepScalar(game, actions[game], &rewards[game], &dones[game]);
+  }
+  for (game = 0; game < games_; ++game) {
+    if (dones[game]) {
+      Reset(game);
+    }
+  }
+}
+
+}  // namespace tigerdragon
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "engine.h"
+
+namespace tigerdragon {
+
+// Steps many independent rounds in lockstep. Per-game fields are stored as
+// structure-of-arrays so Step can advance four games per AVX2 iteration
+// (build with -mavx2; other targets use the equivalent scalar loop).
+// Finished games are redealt automatically.
+class BatchEngine {
+ public:
+  // Deals come from Philox(seed, deal_index = game << 32 | k). A players
+  // count outside 2..kMaxPlayers or a negative games count gives an empty
+  // engine (games() == 0).
+  BatchEngine(int games, int players, uint32_t seed);
+
+  int games() const { return games_; }
+  int players() const { return players_; }
+
+  // actions[i] is an ActionCode for game i. Games whose action is illegal
+  // are left unchanged. rewards[i] is 1 when the mover emptied their hand;
+  // such games report dones[i] = 1 and are redealt before Step returns.
+  void Step(const uint8_t* actions, float* rewards, uint8_t* dones);
+
+  // Legal ActionCodes per game as bit masks (bit kPassCode for Pass).
+  void LegalMasks(uint16_t* out) const;
+
+  int CurrentPlayer(int game) const { return current_[game]; }
+
+  // Scalar view of one game, for checks and debugging. The face-up pile
+  // (GameState::revealed) is not tracked and comes back empty.
+  GameState ToGameState(int game) const;
+
+ private:
+  void Reset(int game);
+  void StepScalar(int game, uint8_t action, float* reward, uint8_t* done);
+#ifdef __AVX2__
+  void StepBlockAvx2(int first, const uint8_t* actions, float* rewards, uint8_t* dones);
+#endif
+
+  int games_ = 0;
+  int players_ = 0;
+  uint32_t seed_ = 0;
+
+  // hands_[player * games_ + game] and bonus_[player * games_ + game].
+  std::vector<uint64_t> hands_;
+  std::vector<int32_t> bonus_;
+  std::vector<int32_t> phase_;
+  std::vector<int32_t> current_;
+  std::vector<int32_t> attack_player_;
+  std::vector<int32_t> attack_tile_;  // kTileKinds when there is no attack.
+  std::vector<uint32_t> deals_;
+};
+
+}  // namespace tigerdragon
@@ -0,0 +1,185 @@
+#include "batch_scheduler.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace tigerdragon {
+
+BatchScheduler::BatchScheduler(const BatchSchedulerConfig& config, const std::vector<BatchedAgent*>& seat_agents)
+    : config_(config) {
+  for (BatchedAgent* agent : seat_agents) {
+    const auto it = std::find(agents_.begin(), agents_.end(), agent);
+    seat_queue_.push_back(static_cast<int>(it - agents_.begin()));
+    if (it == agents_.end()) {
+      agents_.push_back(agent);
+    }
+  }
+  config_.max_batch = std::max(config_.max_batch, 1);
+  config_.step_threads = std::max(config_.step_threads, 1);
+}
+
+std::vector<ScheduledGame> BatchScheduler::Run(int64_t games) {
+  const auto start = Clock::now();
+  stats_ = BatchSchedulerStats{};
+  games_ = games;
+  results_.assign(static_cast<size_t>(games), ScheduledGame{});
+  slots_.assign(static_cast<size_t>(std::max<int64_t>(0, std::min<int64_t>(config_.games_in_flight, games))), Slot{});
+  queues_.assign(agents_.size(), {});
+  ready_.clear();
+  next_game_ = 0;
+  stepping_ = 0;
+  stopping_ = false;
+  active_slots_ = static_cast<int>(slots_.size());
+  for (int slot = 0; slot < static_cast<int>(slots_.size()); ++slot) {
+    StartGame(slot);
+    ready_.push_back(slot);
+  }
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < config_.step_threads; ++i) {
+    threads.emplace_back([this] { StepLoop(); });
+  }
+
+  std::vector<ObservationView> views;
+  std::vector<Action> actions;
+  std::vector<int> batch;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (active_slots_ > 0) {
+    Clock::time_point wake = Clock::time_point::max();
+    bool timed_out = false;
+    const int queue = ReadyQueue(Clock::now(), &wake, &timed_out);
+    if (queue < 0) {
+      if (wake == Clock::time_point::max()) {
+        batch_wake_.wait(lock);
+      } else {
+        batch_wake_.wait_until(lock, wake);
+      }
+      continue;
+    }
+
+    std::vector<Pending>& pending = queues_[queue];
+    const size_t count = std::min(pending.size(), static_cast<size_t>(config_.max_batch));
+    batch.clear();
+    for (size_t i = 0; i < count; ++i) {
+      batch.push_back(pending[i].slot);
+    }
+    pending.erase(pending.begin(), pending.begin() + count);
+    ++stats_.batches;
+    stats_.decisions += static_cast<int64_t>(count);
+    stats_.full_batches += count == static_cast<size_t>(config_.max_batch) ? 1 : 0;
+    stats_.timeout_batches += timed_out ? 1 : 0;
+    lock.unlock();
+
+    // Parked slots are not touched by step threads until re-queued.
+    views.clear();
+    for (int slot : batch) {
+      views.emplace_back(slots_[slot].state, slots_[slot].state.current_player);
+    }
+    actions.resize(count);
+    agents_[queue]->ChooseActions(Span<const ObservationView>(views), Span<Action>(actions));
+    for (size_t i = 0; i < count; ++i) {
+      slots_[batch[i]].action = actions[i];
+      slots_[batch[i]].has_action = true;
+    }
+
+    lock.lock();
+    ready_.insert(ready_.end(), batch.begin(), batch.end());
+    step_wake_.notify_all();
+  }
+  stopping_ = true;
+  lock.unlock();
+  step_wake_.notify_all();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  stats_.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  return std::move(results_);
+}
+
+int BatchScheduler::ReadyQueue(Clock::time_point now, Clock::time_point* wake, bool* timed_out) const {
+  // With every game parked nothing else can join a batch, so waiting for
+  // the deadline would only add latency.
+  const bool idle = ready_.empty() && stepping_ == 0;
+  int fullest = -1;
+  for (int queue = 0; queue < static_cast<int>(queues_.size()); ++queue) {
+    const std::vector<Pending>& pending = queues_[queue];
+    if (pending.empty()) {
+      continue;
+    }
+    if (static_cast<int>(pending.size()) >= config_.max_batch) {
+      return queue;
+    }
+    const auto deadline =
+        pending.front().since +
+        std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(config_.max_latency_ms));
+    if (deadline <= now) {
+      *timed_out = !idle;
+      return queue;
+    }
+    *wake = std::min(*wake, deadline);
+    if (fullest < 0 || pending.size() > queues_[fullest].size()) {
+      fullest = queue;
+    }
+  }
+  return idle ? fullest : -1;
+}
+
+void BatchScheduler::StepLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    step_wake_.wait(lock, [this] { return stopping_ || !ready_.empty(); });
+    if (stopping_) {
+      return;
+    }
+    const int slot = ready_.front();
+    ready_.pop_front();
+    ++stepping_;
+    lock.unlock();
+    Advance(slot);
+    lock.lock();
+    --stepping_;
+    batch_wake_.notify_one();
+  }
+}
+
+void BatchScheduler::Advance(int slot) {
+  Slot& game = slots_[slot];
+  if (game.has_action) {
+    game.has_action = false;
+    if (ApplyAction(game.state, game.action)) {
+      ++game.turns;
+    } else {
+      // An illegal choice ends the game without a winner.
+      game.state.finished = true;
+    }
+  }
+  while (game.state.finished || game.turns >= config_.max_turns) {
+    results_[game.game] = ScheduledGame{game.turns, game.state.finished ? game.state.winner : -1};
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!StartGame(slot)) {
+      --active_slots_;
+      return;
+    }
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  queues_[seat_queue_[game.state.current_player]].push_back(Pending{slot, Clock::now()});
+}
+
+bool BatchScheduler::StartGame(int slot) {
+  if (next_game_ >= games_) {
+    return false;
+  }
+  Slot& game = slots_[slot];
+  game.game = next_game_++;
+  game.turns = 0;
+  game.has_action = false;
+  GameConfig config;
+  config.players = config_.players;
+  config.seed = config_.seed;
+  config.rng = GameConfig::Rng::Philox;
+  config.deal_index = static_cast<uint64_t>(game.game);
+  game.state = CreateInitialState(config);
+  return true;
+}
+
+}  // namespace tigerdragon
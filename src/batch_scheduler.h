@@ -0,0 +1,105 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "batched_agent.h"
+#include "engine.h"
+
+namespace tigerdragon {
+
+struct BatchSchedulerConfig {
+  int players = 2;
+  // Philox key for every deal (GameConfig::seed).
+  uint32_t seed = 0;
+  // Games kept in flight; each waits at most one decision at a time.
+  int games_in_flight = 256;
+  // An agent's waiting decisions go out as one batch once there are this
+  // many, once the oldest has waited max_latency_ms, or as soon as no
+  // other decision can arrive.
+  int max_batch = 64;
+  double max_latency_ms = 1.0;
+  // Threads that advance games between decisions. The thread calling Run
+  // does all ChooseActions calls.
+  int step_threads = 1;
+  int max_turns = 500;
+};
+
+struct ScheduledGame {
+  int turns = 0;
+  int winner = -1;
+};
+
+struct BatchSchedulerStats {
+  int64_t decisions = 0;
+  int64_t batches = 0;
+  int64_t full_batches = 0;     // Sent at max_batch.
+  int64_t timeout_batches = 0;  // Sent at max_latency_ms.
+  double seconds = 0.0;
+
+  double MeanBatch() const { return batches > 0 ? static_cast<double>(decisions) / batches : 0.0; }
+};
+
+// Plays many rounds against BatchedAgents with explicit continuations: a
+// game runs until its next decision, parks in its agent's queue and is
+// resumed by a step thread once the batch holding it returns.
+class BatchScheduler {
+ public:
+  // seat_agents[seat] decides for that seat; an agent serving several seats
+  // gets their decisions in shared batches.
+  BatchScheduler(const BatchSchedulerConfig& config, const std::vector<BatchedAgent*>& seat_agents);
+
+  // Plays rounds 0..games-1; round k is dealt from Philox(seed, k).
+  std::vector<ScheduledGame> Run(int64_t games);
+
+  const BatchSchedulerStats& stats() const { return stats_; }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Slot {
+    GameState state;
+    int64_t game = -1;
+    int turns = 0;
+    bool has_action = false;
+    Action action{};
+  };
+
+  struct Pending {
+    int slot;
+    Clock::time_point since;
+  };
+
+  void StepLoop();
+  // Applies the slot's action and runs it to its next decision, or on to a
+  // new game once it ends. Called without the lock.
+  void Advance(int slot);
+  bool StartGame(int slot);
+  // Queue to send now, or -1; `wake` gets the next latency deadline.
+  int ReadyQueue(Clock::time_point now, Clock::time_point* wake, bool* timed_out) const;
+
+  BatchSchedulerConfig config_;
+  std::vector<BatchedAgent*> agents_;
+  std::vector<int> seat_queue_;
+  BatchSchedulerStats stats_;
+
+  std::vector<Slot> slots_;
+  std::vector<ScheduledGame> results_;
+  int64_t games_ = 0;
+
+  std::mutex mutex_;
+  std::condition_variable step_wake_;
+  std::condition_variable batch_wake_;
+  std::deque<int> ready_;
+  std::vector<std::vector<Pending>> queues_;
+  int64_t next_game_ = 0;
+  int stepping_ = 0;
+  int active_slots_ = 0;
+  bool stopping_ = false;
+};
+
+}  // namespace tigerdragon
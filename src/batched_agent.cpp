@@ -0,0 +1,18 @@
+#include "batched_agent.h"
+
+namespace tigerdragon {
+
+RandomBatchedAgent::RandomBatchedAgent(uint32_t seed) : rng_(seed) {}
+
+void RandomBatchedAgent::ChooseActions(Span<const ObservationView> views, Span<Action> actions) {
+  for (size_t i = 0; i < views.size(); ++i) {
+    uint16_t mask = views[i].legal_mask();
+    std::uniform_int_distribution<int> dist(0, __builtin_popcount(mask) - 1);
+    for (int skip = dist(rng_); skip > 0; --skip) {
+      mask &= mask - 1;
+    }
+    actions[i] = views[i].ActionForCode(static_cast<uint8_t>(__builtin_ctz(mask)));
+  }
+}
+
+}  // namespace tigerdragon
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include "engine.h"
+#include "observation.h"
+
+namespace tigerdragon {
+
+// Non-owning view of a contiguous array (std::span is C++20).
+template <typename T>
+class Span {
+ public:
+  Span() = default;
+  Span(T* data, size_t size) : data_(data), size_(size) {}
+  template <typename U>
+  Span(std::vector<U>& values) : data_(values.data()), size_(values.size()) {}
+  template <typename U>
+  Span(const std::vector<U>& values) : data_(values.data()), size_(values.size()) {}
+
+  T* data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  T& operator[](size_t index) const { return data_[index]; }
+  T* begin() const { return data_; }
+  T* end() const { return data_ + size_; }
+
+ private:
+  T* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// An agent that decides many pending decisions in one call, so a model can
+// evaluate them as one batch. Every view is seen by its player to move.
+class BatchedAgent {
+ public:
+  virtual ~BatchedAgent() = default;
+
+  // Writes a legal action for views[i] to actions[i]; both spans have the
+  // same size. Called from one thread at a time.
+  virtual void ChooseActions(Span<const ObservationView> views, Span<Action> actions) = 0;
+};
+
+// Uniform over the legal move codes, as RandomPlayer with the ActionList.
+class RandomBatchedAgent : public BatchedAgent {
+ public:
+  explicit RandomBatchedAgent(uint32_t seed);
+
+  void ChooseActions(Span<const ObservationView> views, Span<Action> actions) override;
+
+ private:
+  std::mt19937 rng_;
+};
+
+}  // namespace tigerdragon
@@ -0,0 +1,95 @@
+#include "canonical.h"
+
+#include "rng.h"
+
+namespace tigerdragon {
+
+namespace {
+
+constexpr int kHandBits = 4 * kTileKinds;
+constexpr int kBonusBits = 6;
+
+// Writes the low `bits` of `value` at bit `offset`, which may straddle words.
+void PutBits(CanonicalKey& key, int offset, int bits, uint64_t value) {
+  const int word = offset / 64;
+  const int shift = offset % 64;
+  key.words[word] |= value << shift;
+  if (shift + bits > 64) {
+    key.words[word + 1] |= value >> (64 - shift);
+  }
+}
+
+uint64_t GetBits(const CanonicalKey& key, int offset, int bits) {
+  const int word = offset / 64;
+  const int shift = offset % 64;
+  uint64_t value = key.words[word] >> shift;
+  if (shift + bits > 64) {
+    value |= key.words[word + 1] << (64 - shift);
+  }
+  return value & ((uint64_t{1} << bits) - 1);
+}
+
+struct Fields {
+  static constexpr int kBonus = kHandBits * kMaxPlayers;
+  static constexpr int kPhase = kBonus + kBonusBits * kMaxPlayers;
+  static constexpr int kAttackPlayer = kPhase + 2;
+  static constexpr int kAttackTile = kAttackPlayer + 3;
+  static constexpr int kWinner = kAttackTile + 4;
+  static constexpr int kPlayers = kWinner + 3;
+  static constexpr int kEnd = kPlayers + 3;
+};
+static_assert(Fields::kEnd <= 256, "CanonicalKey holds 256 bits");
+
+}  // namespace
+
+CanonicalForm Canonicalize(const GameState& state) {
+  CanonicalForm form;
+  const int players = state.players;
+  const int rotation = state.current_player;
+  form.rotation = rotation;
+  CanonicalKey& key = form.key;
+  for (int seat = 0; seat < players; ++seat) {
+    const int from = FromCanonicalSeat(seat, rotation, players);
+    PutBits(key, seat * kHandBits, kHandBits, state.hands[from].counts);
+    PutBits(key, Fields::kBonus + seat * kBonusBits, kBonusBits, static_cast<uint64_t>(state.bonus_discards[from]));
+  }
+  const int tile = state.attack_tile.has_value() ? static_cast<int>(state.attack_tile->kind) : kTileKinds;
+  const int attack_player = ToCanonicalSeat(state.attack_player, rotation, players);
+  const int winner = ToCanonicalSeat(state.winner, rotation, players);
+  PutBits(key, Fields::kPhase, 2, static_cast<uint64_t>(state.phase));
+  PutBits(key, Fields::kAttackPlayer, 3, static_cast<uint64_t>(attack_player + 1));
+  PutBits(key, Fields::kAttackTile, 4, static_cast<uint64_t>(tile));
+  PutBits(key, Fields::kWinner, 3, static_cast<uint64_t>(winner + 1));
+  PutBits(key, Fields::kPlayers, 3, static_cast<uint64_t>(players));
+  return form;
+}
+
+GameState DecodeCanonicalKey(const CanonicalKey& key) {
+  GameState state;
+  state.players = static_cast<int>(GetBits(key, Fields::kPlayers, 3));
+  for (int seat = 0; seat < state.players; ++seat) {
+    state.hands[seat].counts = GetBits(key, seat * kHandBits, kHandBits);
+    state.bonus_discards[seat] = static_cast<int>(GetBits(key, Fields::kBonus + seat * kBonusBits, kBonusBits));
+  }
+  state.phase = static_cast<GameState::Phase>(GetBits(key, Fields::kPhase, 2));
+  state.finished = state.phase == GameState::Phase::Finished;
+  state.current_player = 0;
+  state.attack_player = static_cast<int>(GetBits(key, Fields::kAttackPlayer, 3)) - 1;
+  const int tile = static_cast<int>(GetBits(key, Fields::kAttackTile, 4));
+  if (tile < kTileKinds) {
+    state.attack_tile = Tile{static_cast<TileKind>(tile)};
+  }
+  state.winner = static_cast<int>(GetBits(key, Fields::kWinner, 3)) - 1;
+  state.hash = ComputeHash(state);
+  return state;
+}
+
+uint64_t CanonicalHash(const CanonicalKey& key) {
+  uint64_t hash = 0;
+  for (uint64_t word : key.words) {
+    hash = Mix64(hash ^ word);
+  }
+  return hash;
+}
+
+}  // namespace tigerdragon
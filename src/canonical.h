@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "engine.h"
+
+namespace tigerdragon {
+
+// A GameState up to seat rotation, seats renumbered so the player to move
+// is seat 0. Hands are kind-count multisets already, so tile order needs
+// no further reduction. Covers what ComputeHash covers: hands, bonus
+// counts, phase, attack player and tile, winner; the face-up pile
+// (GameState::revealed) does not change the game from here on and is left
+// out.
+//
+// Layout: words[0..3] bits 0-199 are the five 40-bit hands, then bonus
+// counts (6 bits per seat), phase, attack seat + 1, attack tile (10 for
+// none), winner seat + 1 and players.
+struct CanonicalKey {
+  std::array<uint64_t, 4> words{};
+
+  bool operator==(const CanonicalKey& other) const { return words == other.words; }
+  bool operator!=(const CanonicalKey& other) const { return words != other.words; }
+};
+
+struct CanonicalForm {
+  CanonicalKey key;
+  // Absolute seat that became canonical seat 0.
+  int rotation = 0;
+};
+
+CanonicalForm Canonicalize(const GameState& state);
+
+// The state `key` was made from, with seat 0 to move (hash recomputed,
+// revealed empty).
+GameState DecodeCanonicalKey(const CanonicalKey& key);
+
+// 64-bit digest of a key for hash tables.
+uint64_t CanonicalHash(const CanonicalKey& key);
+
+// Seat and action mapping between a state and its canonical form.
+inline int ToCanonicalSeat(int seat, int rotation, int players) {
+  return seat < 0 ? seat : (seat - rotation + players) % players;
+}
+
+inline int FromCanonicalSeat(int seat, int rotation, int players) {
+  return seat < 0 ? seat : (seat + rotation) % players;
+}
+
+inline Action ToCanonicalAction(Action action, int rotation, int players) {
+  action.player = ToCanonicalSeat(action.player, rotation, players);
+  return action;
+}
+
+inline Action FromCanonicalAction(Action action, int rotation, int players) {
+  action.player = FromCanonicalSeat(action.player, rotation, players);
+  return action;
+}
+
+}  // namespace tigerdragon
@@ -0,0 +1,193 @@
+#include "determinization.h"
+
+#include <algorithm>
+
+namespace tigerdragon {
+
+namespace {
+
+constexpr int kMaxKindCount = DeckCount(TileKind::Num8);
+
+double Factorial(int n) {
+  double result = 1.0;
+  for (int i = 2; i <= n; ++i) {
+    result *= i;
+  }
+  return result;
+}
+
+}  // namespace
+
+Observation MakeObservation(const GameState& state, int seat) {
+  Observation observation;
+  observation.players = state.players;
+  observation.seat = seat;
+  observation.phase = state.phase;
+  observation.current_player = state.current_player;
+  observation.attack_player = state.attack_player;
+  observation.attack_tile = state.attack_tile;
+  observation.bonus_discards = state.bonus_discards;
+  for (int player = 0; player < state.players; ++player) {
+    observation.hand_sizes[player] = state.hands[player].Size();
+  }
+  observation.own_hand = state.hands[seat];
+  observation.revealed = state.revealed;
+  return observation;
+}
+
+DeterminizationSampler::DeterminizationSampler(const Observation& observation)
+    : observation_(observation) {
+  std::array<int, kTileKinds> unseen{};
+  // suffix[k]: unseen tiles of kinds k..9.
+  std::array<int, kTileKinds + 1> suffix{};
+  for (int kind = kTileKinds - 1; kind >= 0; --kind) {
+    const TileKind tile = static_cast<TileKind>(kind);
+    unseen[kind] = DeckCount(tile) - observation.own_hand.Count(tile) - observation.revealed.Count(tile);
+    if (unseen[kind] < 0) {
+      return;
+    }
+    suffix[kind] = suffix[kind + 1] + unseen[kind];
+  }
+
+  for (int offset = 1; offset < observation.players; ++offset) {
+    const int seat = (observation.seat + offset) % observation.players;
+    radix_[opponent_count_] = observation.hand_sizes[seat] + 1;
+    strides_[opponent_count_] = state_count_;
+    state_count_ *= radix_[opponent_count_];
+    full_index_ += observation.hand_sizes[seat] * strides_[opponent_count_];
+    opponents_[opponent_count_++] = seat;
+  }
+  int opponent_tiles = 0;
+  for (int opponent = 0; opponent < opponent_count_; ++opponent) {
+    opponent_tiles += radix_[opponent] - 1;
+  }
+  // Tiles no opponent holds: face-down discards and undealt tiles. No kind
+  // can leave more than this many unassigned.
+  const int hidden = suffix[0] - opponent_tiles;
+  if (hidden < 0) {
+    return;
+  }
+
+  // Running sums of the row being built, before they become thresholds.
+  std::vector<double> running;
+  std::array<double, kMaxKindCount + 1> inverse_factorial{};
+  for (int n = 0; n <= kMaxKindCount; ++n) {
+    inverse_factorial[n] = 1.0 / Factorial(n);
+  }
+
+  // Before kind k the opponents still need `size` (the sum of the remaining
+  // sizes) tiles. Only rows with opponent_tiles - (unseen before k) <= size
+  // (reachable from the observed sizes) and size <= suffix[k] (fillable)
+  // can be nonzero, so the others are skipped.
+  weights_[kTileKinds].assign(state_count_, 0.0);
+  weights_[kTileKinds][0] = 1.0;
+  for (int kind = kTileKinds - 1; kind >= 0; --kind) {
+    const std::vector<double>& next = weights_[kind + 1];
+    std::vector<double>& current = weights_[kind];
+    std::vector<int32_t>& rows = rows_[kind];
+    std::vector<Term>& terms = terms_[kind];
+    current.assign(state_count_, 0.0);
+    rows.assign(state_count_ + 1, 0);
+    const int lowest = opponent_tiles - (suffix[0] - suffix[kind]);
+    const double pool_factorial = Factorial(unseen[kind]);
+    const int last_opponent = opponent_count_ - 1;
+    std::array<int, kMaxPlayers - 1> remaining{};
+    std::array<int, kMaxPlayers> capacity{};
+    int size = 0;
+    int min_take = 0;
+    double total = 0.0;
+    // Gives take[opponent..] tiles of this kind, at least min_take in all:
+    // the row moved to must stay fillable and at most `hidden` tiles of a
+    // kind can go unassigned.
+    // `scale` is unseen! / (take[0]! ... take[opponent - 1]!).
+    auto enumerate = [&](auto&& self, int opponent, int taken, int next_index, uint32_t take_nibbles,
+                         double scale) -> void {
+      const int first = std::max(0, min_take - taken - capacity[opponent + 1]);
+      const int last = std::min(capacity[opponent] - capacity[opponent + 1], unseen[kind] - taken);
+      if (opponent < last_opponent) {
+        for (int take = first; take <= last; ++take) {
+          self(self, opponent + 1, taken + take, next_index - take * strides_[opponent],
+               take_nibbles | static_cast<uint32_t>(take) << (4 * opponent), scale * inverse_factorial[take]);
+        }
+        return;
+      }
+      for (int take = first; take <= last; ++take) {
+        const int to = next_index - take * strides_[opponent];
+        const double weight =
+            scale * inverse_factorial[take] * inverse_factorial[unseen[kind] - taken - take] * next[to];
+        if (weight > 0.0) {
+          total += weight;
+          running.push_back(total);
+          terms.push_back(Term{0, static_cast<uint16_t>(take_nibbles | static_cast<uint32_t>(take) << (4 * opponent)),
+                               static_cast<uint16_t>(to)});
+        }
+      }
+    };
+    for (int index = 0; index < state_count_; ++index) {
+      rows[index] = static_cast<int32_t>(terms.size());
+      if (size >= lowest && size <= suffix[kind]) {
+        // capacity[i]: tiles opponents i.. can still take of this kind.
+        for (int opponent = opponent_count_ - 1; opponent >= 0; --opponent) {
+          const bool excluded = (observation.excluded[opponents_[opponent]] & (1u << kind)) != 0;
+          capacity[opponent] = capacity[opponent + 1] + (excluded ? 0 : remaining[opponent]);
+        }
+        min_take = std::max(unseen[kind] - hidden, size - suffix[kind + 1]);
+        total = 0.0;
+        running.clear();
+        enumerate(enumerate, 0, 0, index, 0, pool_factorial);
+        current[index] = total;
+        for (size_t i = 0; i < running.size(); ++i) {
+          terms[rows[index] + i].threshold =
+              static_cast<uint32_t>(std::min(running[i] / total * 0x1.0p32, 0x1.0p32 - 1.0));
+        }
+      }
+      for (int opponent = 0; opponent < opponent_count_; ++opponent) {
+        if (remaining[opponent] + 1 < radix_[opponent]) {
+          ++remaining[opponent];
+          ++size;
+          break;
+        }
+        size -= remaining[opponent];
+        remaining[opponent] = 0;
+      }
+    }
+    rows[state_count_] = static_cast<int32_t>(terms.size());
+  }
+  valid_ = weights_[0][full_index_] > 0.0;
+}
+
+void DeterminizationSampler::Sample(PhiloxEngine& rng, GameState* out) const {
+  GameState& state = *out;
+  state = GameState{};
+  state.players = observation_.players;
+  state.phase = observation_.phase;
+  state.finished = observation_.phase == GameState::Phase::Finished;
+  state.current_player = observation_.current_player;
+  state.attack_player = observation_.attack_player;
+  state.attack_tile = observation_.attack_tile;
+  state.bonus_discards = observation_.bonus_discards;
+  state.revealed = observation_.revealed;
+  state.hands[observation_.seat] = observation_.own_hand;
+
+  int index = full_index_;
+  for (int kind = 0; kind < kTileKinds; ++kind) {
+    const Term* begin = terms_[kind].data() + rows_[kind][index];
+    const Term* end = terms_[kind].data() + rows_[kind][index + 1];
+    const uint32_t target = rng();
+    const Term* term = std::upper_bound(begin, end - 1, target,
+                                        [](uint32_t value, const Term& t) { return value < t.threshold; });
+    for (int opponent = 0; opponent < opponent_count_; ++opponent) {
+      state.hands[opponents_[opponent]].Add(static_cast<TileKind>(kind), (term->take >> (4 * opponent)) & 0xF);
+    }
+    index = term->next_index;
+  }
+  state.hash = ComputeHash(state);
+}
+
+void DeterminizationSampler::SampleBatch(PhiloxEngine& rng, GameState* out, int count) const {
+  for (int i = 0; i < count; ++i) {
+    Sample(rng, &out[i]);
+  }
+}
+
+}  // namespace tigerdragon
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "engine.h"
+#include "rng.h"
+
+namespace tigerdragon {
+
+// What one seat knows about a round: its own hand, everything public, and
+// optional per-seat exclusions (kinds a seat is known not to hold, e.g.
+// from passes when the caller treats them as forced).
+struct Observation {
+  int players = 0;
+  int seat = 0;
+  GameState::Phase phase = GameState::Phase::Attack;
+  int current_player = 0;
+  int attack_player = -1;
+  std::optional<Tile> attack_tile;
+  std::array<int, kMaxPlayers> bonus_discards{};
+  std::array<int, kMaxPlayers> hand_sizes{};
+  Hand own_hand;
+  Hand revealed;
+  std::array<uint16_t, kMaxPlayers> excluded{};
+};
+
+Observation MakeObservation(const GameState& state, int seat);
+
+// Draws full GameStates uniformly from the deals consistent with an
+// Observation. Unseen tiles (deck minus own hand minus face-up plays) are
+// split between the other seats' hands and a hidden pile (face-down bonus
+// discards plus undealt tiles). A DP over the 10 tile kinds counts the
+// completions for every vector of remaining opponent hand sizes, so each
+// sample is one weighted choice per kind with no rejection. Only size
+// vectors reachable from the observed sizes are evaluated, and the terms of
+// each weight are kept with fixed-point running sums, so a choice is one
+// 32-bit draw and one binary search.
+class DeterminizationSampler {
+ public:
+  explicit DeterminizationSampler(const Observation& observation);
+
+  // False when no deal matches the observation (e.g. contradictory
+  // exclusions); Sample must not be called then.
+  bool valid() const { return valid_; }
+
+  // Number of consistent tile-level deals.
+  double ConsistentDeals() const { return valid_ ? weights_[0][full_index_] : 0.0; }
+
+  void Sample(PhiloxEngine& rng, GameState* out) const;
+
+  // Writes `count` samples to out[0..count).
+  void SampleBatch(PhiloxEngine& rng, GameState* out, int count) const;
+
+ private:
+  // One nonzero term of weights_[k][index]: a way to give the unseen tiles
+  // of kind k to the opponents (take[i] in bits 4i..4i+3) and the row it
+  // leads to (hand sizes sum to at most kDeckSize, so rows fit 16 bits).
+  // threshold is the row's running sum up to this term as a fraction of
+  // 2^32.
+  struct Term {
+    uint32_t threshold = 0;
+    uint16_t take = 0;
+    uint16_t next_index = 0;
+  };
+
+  Observation observation_;
+  int opponent_count_ = 0;
+  std::array<int, kMaxPlayers - 1> opponents_{};
+  std::array<int, kMaxPlayers - 1> radix_{};
+  std::array<int, kMaxPlayers - 1> strides_{};
+  int state_count_ = 1;
+  int full_index_ = 0;
+  bool valid_ = false;
+  // weights_[k][index]: deals of kinds k..9 given remaining opponent sizes.
+  std::array<std::vector<double>, kTileKinds + 1> weights_;
+  // terms_[k][rows_[k][index] .. rows_[k][index + 1]): the terms of
+  // weights_[k][index].
+  std::array<std::vector<int32_t>, kTileKinds> rows_;
+  std::array<std::vector<Term>, kTileKinds> terms_;
+};
+
+}  // namespace tigerdragon
@@ -0,0 +1,163 @@
+#include "endgame_solver.h"
+
+#include <algorithm>
+
+#include "rng.h"
+
+namespace tigerdragon {
+
+namespace {
+
+constexpr int64_t kClockCheckInterval = 1024;
+
+// Search values: +(1 + tile) when the root player wins, -(1 + tile) when it
+// loses, where tile is the kind that ends the round. 0 means aborted.
+int Encode(bool root_wins, TileKind tile) {
+  const int magnitude = 1 + static_cast<int>(tile);
+  return root_wins ? magnitude : -magnitude;
+}
+
+TileKind DecodeTile(int value) {
+  return static_cast<TileKind>((value < 0 ? -value : value) - 1);
+}
+
+// Table move first, then tiles before passing, with Tiger/Dragon attacks
+// (which cannot be answered) ahead of numbers.
+int OrderScore(const GameState& state, const Action& action, uint8_t table_move) {
+  if (ActionCode(action) == table_move) {
+    return 3;
+  }
+  if (action.type == Action::Type::Pass) {
+    return 0;
+  }
+  if (state.phase == GameState::Phase::Attack &&
+      (action.tile == TileKind::Tiger || action.tile == TileKind::Dragon)) {
+    return 2;
+  }
+  return 1;
+}
+
+}  // namespace
+
+int TilesInHands(const GameState& state) {
+  int tiles = 0;
+  for (int player = 0; player < state.players; ++player) {
+    tiles += state.hands[player].Size();
+  }
+  return tiles;
+}
+
+EndgameSolver::EndgameSolver(const EndgameConfig& config, TranspositionTable* table)
+    : config_(config), table_(table) {
+  if (table_ == nullptr) {
+    owned_table_ = std::make_unique<TranspositionTable>(config_.table_megabytes);
+    table_ = owned_table_.get();
+  }
+}
+
+EndgameResult EndgameSolver::Solve(const GameState& state, int root_player) {
+  EndgameResult result;
+  root_player_ = root_player;
+  root_key_ = Mix64(0xE4D6A3B1C2F50789ULL + static_cast<uint64_t>(root_player));
+  nodes_ = 0;
+  aborted_ = false;
+  deadline_ = std::chrono::steady_clock::now() +
+              std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                  std::chrono::duration<double, std::milli>(config_.time_limit_ms));
+
+  if (state.finished) {
+    return result;
+  }
+  GameState work = state;
+  uint8_t best_code = 0xFF;
+  const int value = Search(work, &best_code);
+  result.nodes = nodes_;
+  if (value == 0 || best_code == 0xFF) {
+    return result;
+  }
+
+  const bool root_wins = value > 0;
+  result.outcome = root_wins ? EndgameResult::Outcome::Win : EndgameResult::Outcome::Loss;
+  if (root_wins) {
+    result.winner = root_player;
+  } else if (state.players == 2) {
+    result.winner = 1 - root_player;
+  }
+  result.best_move = ActionFromCode(state, best_code);
+  result.finishing_tile = DecodeTile(value);
+  return result;
+}
+
+bool EndgameSolver::OutOfBudget() {
+  if (config_.max_nodes > 0 && nodes_ > config_.max_nodes) {
+    return true;
+  }
+  return config_.time_limit_ms > 0.0 && nodes_ % kClockCheckInterval == 0 &&
+         std::chrono::steady_clock::now() >= deadline_;
+}
+
+int EndgameSolver::Search(GameState& state, uint8_t* best_code) {
+  ++nodes_;
+  if (aborted_ || OutOfBudget()) {
+    aborted_ = true;
+    return 0;
+  }
+
+  const uint64_t key = state.hash ^ root_key_;
+  TranspositionTable::Entry entry;
+  uint8_t table_move = 0xFF;
+  if (table_->Probe(key, &entry)) {
+    if (entry.bound == TranspositionTable::Bound::Exact && entry.value != 0) {
+      *best_code = entry.move;
+      return entry.value;
+    }
+    table_move = entry.move;
+  }
+
+  ActionList moves;
+  GenerateLegalActions(state, &moves);
+  std::array<int, kMaxLegalActions> order{};
+  for (int i = 0; i < moves.size; ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.begin() + moves.size, [&](int a, int b) {
+    return OrderScore(state, moves[a], table_move) > OrderScore(state, moves[b], table_move);
+  });
+
+  const bool maximizing = state.current_player == root_player_;
+  int best = 0;
+  for (int i = 0; i < moves.size; ++i) {
+    const Action& move = moves[order[i]];
+    UndoRecord undo;
+    ApplyAction(state, move, &undo);
+    int value;
+    if (state.finished) {
+      value = Encode(state.winner == root_player_, move.tile);
+    } else {
+      uint8_t child_code = 0xFF;
+      value = Search(state, &child_code);
+    }
+    UndoAction(state, undo);
+    if (value == 0) {
+      return 0;
+    }
+    const bool good = maximizing ? value > 0 : value < 0;
+    if (best == 0 || good) {
+      best = value;
+      *best_code = ActionCode(move);
+    }
+    if (good) {
+      break;
+    }
+  }
+
+  TranspositionTable::Entry store;
+  store.value = static_cast<int16_t>(best);
+  store.depth = static_cast<uint8_t>(TilesInHands(state));
+  store.bound = TranspositionTable::Bound::Exact;
+  store.move = *best_code;
+  table_->Store(key, store);
+  return best;
+}
+
+}  // namespace tigerdragon
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include "engine.h"
+#include "transposition_table.h"
+
+namespace tigerdragon {
+
+struct EndgameConfig {
+  // The search gives up (Outcome::Unknown) past either limit; 0 disables a
+  // limit.
+  int64_t max_nodes = 1000000;
+  double time_limit_ms = 0.0;
+  // Size of the table the solver allocates when none is passed in.
+  size_t table_megabytes = 16;
+};
+
+struct EndgameResult {
+  enum class Outcome : uint8_t {
+    Unknown,
+    Win,
+    Loss,
+  };
+
+  Outcome outcome = Outcome::Unknown;
+  // `root_player` on Win; the opponent on a 2-player Loss; otherwise -1.
+  int winner = -1;
+  Action best_move;
+  // Tile that ends the round on the line found. Only outcome and winner are
+  // exact: the search stops at the first winning line (Tiger/Dragon
+  // finishes are tried first), so this is not the highest-scoring finish,
+  // and on a Loss it comes from the first line searched.
+  TileKind finishing_tile = TileKind::Num1;
+  int64_t nodes = 0;
+};
+
+// Exact solver for fully known positions. Every non-pass move removes a
+// tile, so the game tree is finite and acyclic. The search is paranoid
+// alpha-beta over a binary value: does `root_player` win against every
+// combination of opponent replies. With two players this is the exact
+// game-theoretic result. Solved positions are memoised in a
+// TranspositionTable keyed by GameState::hash and the root player; the
+// table may be shared with other solvers and threads.
+class EndgameSolver {
+ public:
+  // `table` is optional and must outlive the solver.
+  explicit EndgameSolver(const EndgameConfig& config, TranspositionTable* table = nullptr);
+
+  EndgameResult Solve(const GameState& state, int root_player);
+  EndgameResult Solve(const GameState& state) { return Solve(state, state.current_player); }
+
+ private:
+  int Search(GameState& state, uint8_t* best_code);
+  bool OutOfBudget();
+
+  EndgameConfig config_;
+  std::unique_ptr<TranspositionTable> owned_table_;
+  TranspositionTable* table_;
+  int root_player_ = 0;
+  uint64_t root_key_ = 0;
+  int64_t nodes_ = 0;
+  bool aborted_ = false;
+  std::chrono::steady_clock::time_point deadline_;
+};
+
+// Tiles still held by all players.
+int TilesInHands(const GameState& state);
+
+}  // namespace tigerdragon
@@ -1,188 +1,300 @@
 #include "engine.h"
 
+#include "rng.h"
+
 #include <algorithm>
 #include <array>
 #include <sstream>
+#include <stdexcept>
 
 namespace tigerdragon {
 
 namespace {
 
-bool IsEven(TileKind kind) {
-  return kind == TileKind::Num2 || kind == TileKind::Num4 || kind == TileKind::Num6 ||
-         kind == TileKind::Num8;
-}
-
-bool IsOdd(TileKind kind) {
-  return kind == TileKind::Num1 || kind == TileKind::Num3 || kind == TileKind::Num5 ||
-         kind == TileKind::Num7;
-}
-
-bool IsNumber(TileKind kind) {
-  return kind <= TileKind::Num8;
-}
-
-int NumberValue(TileKind kind) {
-  return static_cast<int>(kind) + 1;
+bool CanDefendWith(TileKind attack, TileKind defend) {
+  return (DefendMask(attack) & KindBit(defend)) != 0;
 }
 
-bool CanDefendWith(TileKind attack, TileKind defend) {
-  if (IsNumber(attack) && IsNumber(defend)) {
-    return NumberValue(attack) == NumberValue(defend);
-  }
-  if (defend == TileKind::Tiger) {
-    return IsEven(attack);
-  }
-  if (defend == TileKind::Dragon) {
-    return IsOdd(attack);
-  }
-  return false;
+// Seat after `seat` at a table of N.
+template <int N>
+constexpr int NextSeat(int seat) {
+  return seat + 1 == N ? 0 : seat + 1;
 }
 
-int HandSizeForPlayers(int players) {
+// Runs fn(std::integral_constant<int, N>{}) for players = N in 2..5, else
+// fallback().
+template <typename Fn, typename Fallback>
+auto WithPlayerCount(int players, Fn&& fn, Fallback&& fallback) {
   switch (players) {
     case 2:
-      return 12;
+      return fn(std::integral_constant<int, 2>{});
     case 3:
-      return 11;
+      return fn(std::integral_constant<int, 3>{});
     case 4:
-      return 9;
+      return fn(std::integral_constant<int, 4>{});
     case 5:
-      return 7;
+      return fn(std::integral_constant<int, 5>{});
     default:
-      return 0;
+      return fallback();
   }
 }
 
-}  // namespace
-
-std::vector<Tile> BuildDeck() {
-  std::vector<Tile> deck;
-  deck.reserve(38);
+std::array<Tile, kDeckSize> BuildDeckArray() {
+  std::array<Tile, kDeckSize> deck{};
+  int next = 0;
   for (int value = 1; value <= 8; ++value) {
     for (int count = 0; count < value; ++count) {
-      deck.push_back(Tile{static_cast<TileKind>(value - 1)});
+      deck[next++] = Tile{static_cast<TileKind>(value - 1)};
     }
   }
-  deck.push_back(Tile{TileKind::Tiger});
-  deck.push_back(Tile{TileKind::Dragon});
+  deck[next++] = Tile{TileKind::Tiger};
+  deck[next++] = Tile{TileKind::Dragon};
   return deck;
 }
 
-GameState CreateInitialState(const GameConfig& config) {
-  GameState state;
-  state.players = config.players;
-  state.current_player = 0;
-  state.attack_player = -1;
-  state.hands.assign(config.players, {});
-  state.bonus_discards.assign(config.players, 0);
+struct ZobristKeys {
+  uint64_t hand[kMaxPlayers][kTileKinds][9];
+  uint64_t bonus[kMaxPlayers][kDeckSize + 1];
+  uint64_t phase[4];
+  uint64_t current[kMaxPlayers];
+  uint64_t attack_player[kMaxPlayers + 1];
+  uint64_t attack_tile[kTileKinds + 1];
+};
+
+ZobristKeys BuildZobristKeys() {
+  ZobristKeys keys{};
+  uint64_t seed = 0x7469676572647261ULL;
+  for (auto& player : keys.hand) {
+    for (auto& kind : player) {
+      kind[0] = 0;
+      for (int count = 1; count < 9; ++count) {
+        kind[count] = SplitMix64(seed);
+      }
+    }
+  }
+  for (auto& player : keys.bonus) {
+    player[0] = 0;
+    for (int count = 1; count <= kDeckSize; ++count) {
+      player[count] = SplitMix64(seed);
+    }
+  }
+  for (auto& key : keys.phase) key = SplitMix64(seed);
+  for (auto& key : keys.current) key = SplitMix64(seed);
+  for (auto& key : keys.attack_player) key = SplitMix64(seed);
+  for (auto& key : keys.attack_tile) key = SplitMix64(seed);
+  return keys;
+}
 
-  std::vector<Tile> deck = BuildDeck();
-  std::mt19937 rng(config.seed);
-  std::shuffle(deck.begin(), deck.end(), rng);
+const ZobristKeys kZobrist = BuildZobristKeys();
 
-  const int hand_size = HandSizeForPlayers(config.players);
-  for (int player = 0; player < config.players; ++player) {
-    state.hands[player].insert(state.hands[player].end(),
-                               deck.begin() + player * hand_size,
-                               deck.begin() + (player + 1) * hand_size);
-  }
+// In the rules below `N` is the player count wherever seats wrap; the
+// public functions dispatch on GameState::players once per call.
 
-  const int start_player = 0;
-  state.current_player = start_player;
-  state.attack_player = start_player;
+// Hash of the scalar fields; ApplyAction swaps the old value for the new one.
+uint64_t ScalarHash(const GameState& state) {
+  const int tile = state.attack_tile.has_value() ? static_cast<int>(state.attack_tile->kind)
+                                                 : kTileKinds;
+  return kZobrist.phase[static_cast<int>(state.phase)] ^ kZobrist.current[state.current_player] ^
+         kZobrist.attack_player[state.attack_player + 1] ^ kZobrist.attack_tile[tile];
+}
 
-  const int start_draw_index = hand_size * config.players;
-  if (start_draw_index < static_cast<int>(deck.size())) {
-    state.hands[start_player].push_back(deck[start_draw_index]);
+template <int N>
+uint64_t HashState(const GameState& state) {
+  uint64_t hash = ScalarHash(state);
+  for (int player = 0; player < N; ++player) {
+    for (int kind = 0; kind < kTileKinds; ++kind) {
+      hash ^= kZobrist.hand[player][kind][state.hands[player].Count(static_cast<TileKind>(kind))];
+    }
+    hash ^= kZobrist.bonus[player][state.bonus_discards[player]];
   }
+  return hash;
+}
 
-  state.phase = GameState::Phase::Attack;
-  return state;
+void RemoveTile(GameState& state, int player, TileKind kind) {
+  Hand& hand = state.hands[player];
+  const int count = hand.Count(kind);
+  const auto& keys = kZobrist.hand[player][static_cast<int>(kind)];
+  state.hash ^= keys[count] ^ keys[count - 1];
+  hand.Remove(kind);
 }
 
-std::vector<Action> GenerateLegalActions(const GameState& state) {
-  std::vector<Action> actions;
-  if (state.finished) {
-    return actions;
+// A player who empties their hand wins the round.
+void CheckFinished(GameState& state, int player) {
+  if (state.hands[player].Empty()) {
+    state.finished = true;
+    state.winner = player;
+    state.phase = GameState::Phase::Finished;
   }
+}
 
-  const int player = state.current_player;
-  const auto& hand = state.hands[player];
+void AddBonusDiscard(GameState& state, int player) {
+  const int count = state.bonus_discards[player];
+  state.hash ^= kZobrist.bonus[player][count] ^ kZobrist.bonus[player][count + 1];
+  state.bonus_discards[player] = count + 1;
+}
 
-  if (state.phase == GameState::Phase::Attack) {
-    for (int i = 0; i < static_cast<int>(hand.size()); ++i) {
-      actions.push_back(Action{Action::Type::Attack, player, i});
+template <int N>
+void Deal(const GameConfig& config, GameState& state) {
+  std::array<Tile, kDeckSize> deck = BuildDeckArray();
+  if (config.rng == GameConfig::Rng::Philox) {
+    PhiloxEngine rng(config.seed, config.deal_index);
+    for (int i = kDeckSize - 1; i > 0; --i) {
+      std::swap(deck[i], deck[rng.Below(static_cast<uint32_t>(i + 1))]);
     }
-    return actions;
+  } else {
+    std::mt19937 rng(config.seed);
+    std::shuffle(deck.begin(), deck.end(), rng);
   }
 
-  if (state.phase == GameState::Phase::BonusReceive) {
-    for (int i = 0; i < static_cast<int>(hand.size()); ++i) {
-      actions.push_back(Action{Action::Type::BonusReceive, player, i});
+  constexpr int hand_size = HandSizeForPlayers(N);
+  for (int player = 0; player < N; ++player) {
+    for (int i = player * hand_size; i < (player + 1) * hand_size; ++i) {
+      state.hands[player].Add(deck[i].kind);
     }
-    return actions;
   }
 
+  const int start_player = config.start_player;
+  state.current_player = start_player;
+  state.attack_player = start_player;
+
+  constexpr int start_draw_index = hand_size * N;
+  if (start_draw_index < kDeckSize) {
+    state.hands[start_player].Add(deck[start_draw_index].kind);
+  }
+
+  state.phase = GameState::Phase::Attack;
+  state.hash = HashState<N>(state);
+}
+
+Action CodeToAction(const GameState& state, uint8_t code) {
+  const int player = state.current_player;
+  if (code == kPassCode) {
+    return Action{Action::Type::Pass, player, -1};
+  }
+  Action::Type type = Action::Type::Attack;
   if (state.phase == GameState::Phase::Defend) {
-    if (!state.attack_tile.has_value()) {
-      return actions;
-    }
+    type = Action::Type::Defend;
+  } else if (state.phase == GameState::Phase::BonusReceive) {
+    type = Action::Type::BonusReceive;
+  }
+  const TileKind tile = static_cast<TileKind>(code);
+  return Action{type, player, state.hands[player].CountBelow(tile), tile};
+}
 
-    bool has_defend = false;
-    for (int i = 0; i < static_cast<int>(hand.size()); ++i) {
-      if (CanDefendWith(state.attack_tile->kind, hand[i].kind)) {
-        actions.push_back(Action{Action::Type::Defend, player, i});
-        has_defend = true;
+uint16_t TileMask(const GameState& state) {
+  if (state.finished) {
+    return 0;
+  }
+  const uint16_t held = state.hands[state.current_player].KindMask();
+  switch (state.phase) {
+    case GameState::Phase::Attack:
+    case GameState::Phase::BonusReceive:
+      return held;
+    case GameState::Phase::Defend:
+      if (!state.attack_tile.has_value()) {
+        return 0;
       }
-    }
+      return held & DefendMask(state.attack_tile->kind);
+    case GameState::Phase::Finished:
+      break;
+  }
+  return 0;
+}
 
-    actions.push_back(Action{Action::Type::Pass, player, -1});
+uint16_t CodeMask(const GameState& state) {
+  uint16_t mask = TileMask(state);
+  if (state.phase == GameState::Phase::Defend && !state.finished) {
+    mask |= 1u << kPassCode;
+  }
+  return mask;
+}
 
-    if (!has_defend) {
-      return actions;
+int ListActions(const GameState& state, ActionList* out) {
+  out->size = 0;
+  if (state.finished) {
+    return 0;
+  }
+
+  Action::Type type = Action::Type::Attack;
+  if (state.phase == GameState::Phase::Defend) {
+    if (!state.attack_tile.has_value()) {
+      return 0;
     }
-    return actions;
+    type = Action::Type::Defend;
+  } else if (state.phase == GameState::Phase::BonusReceive) {
+    type = Action::Type::BonusReceive;
+  } else if (state.phase != GameState::Phase::Attack) {
+    return 0;
   }
 
-  return actions;
+  const int player = state.current_player;
+  const Hand& hand = state.hands[player];
+  const uint16_t mask = TileMask(state);
+  int index = 0;
+  for (int kind = 0; kind < kTileKinds; ++kind) {
+    if (mask & (1u << kind)) {
+      out->actions[out->size++] = Action{type, player, index, static_cast<TileKind>(kind)};
+    }
+    index += hand.Count(static_cast<TileKind>(kind));
+  }
+  if (type == Action::Type::Defend) {
+    out->actions[out->size++] = Action{Action::Type::Pass, player, -1};
+  }
+  return out->size;
 }
 
-bool ApplyAction(GameState& state, const Action& action) {
+template <int N>
+bool Apply(GameState& state, const Action& action, UndoRecord* undo) {
   if (state.finished || action.player != state.current_player) {
     return false;
   }
 
-  auto& hand = state.hands[action.player];
-
-  auto remove_from_hand = [&](int index) -> Tile {
-    Tile tile = hand[index];
-    hand.erase(hand.begin() + index);
-    return tile;
-  };
+  Hand& hand = state.hands[action.player];
+  if (action.type != Action::Type::Pass && action.hand_index >= 0 &&
+      static_cast<unsigned>(action.hand_index - hand.CountBelow(action.tile)) >=
+          static_cast<unsigned>(hand.Count(action.tile))) {
+    return false;
+  }
+  if (undo != nullptr) {
+    undo->phase = state.phase;
+    undo->finished = state.finished;
+    undo->attack_tile = state.attack_tile;
+    undo->player = static_cast<int8_t>(action.player);
+    undo->current_player = static_cast<int8_t>(state.current_player);
+    undo->attack_player = static_cast<int8_t>(state.attack_player);
+    undo->winner = static_cast<int8_t>(state.winner);
+    undo->removed = action.type == Action::Type::Pass ? -1 : static_cast<int8_t>(action.tile);
+    undo->bonus = state.phase == GameState::Phase::BonusReceive;
+    undo->hash = state.hash;
+  }
+  const uint64_t scalar_hash = ScalarHash(state);
 
   if (state.phase == GameState::Phase::Attack) {
-    if (action.type != Action::Type::Attack || action.hand_index < 0 ||
-        action.hand_index >= static_cast<int>(hand.size())) {
+    if (action.type != Action::Type::Attack || hand.Count(action.tile) == 0) {
       return false;
     }
 
-    state.attack_tile = remove_from_hand(action.hand_index);
+    RemoveTile(state, action.player, action.tile);
+    state.attack_tile = Tile{action.tile};
+    state.revealed.Add(action.tile);
     state.attack_player = action.player;
     state.phase = GameState::Phase::Defend;
-    state.current_player = (action.player + 1) % state.players;
+    state.current_player = NextSeat<N>(action.player);
+    CheckFinished(state, action.player);
+    state.hash ^= scalar_hash ^ ScalarHash(state);
     return true;
   }
 
   if (state.phase == GameState::Phase::BonusReceive) {
-    if (action.type != Action::Type::BonusReceive || action.hand_index < 0 ||
-        action.hand_index >= static_cast<int>(hand.size())) {
+    if (action.type != Action::Type::BonusReceive || hand.Count(action.tile) == 0) {
       return false;
     }
 
-    remove_from_hand(action.hand_index);
-    state.bonus_discards[action.player] += 1;
+    RemoveTile(state, action.player, action.tile);
+    AddBonusDiscard(state, action.player);
     state.phase = GameState::Phase::Attack;
+    CheckFinished(state, action.player);
+    state.hash ^= scalar_hash ^ ScalarHash(state);
     return true;
   }
 
@@ -192,33 +304,168 @@ bool ApplyAction(GameState& state, const Action& action) {
     }
 
     if (action.type == Action::Type::Pass) {
-      state.current_player = (state.current_player + 1) % state.players;
+      state.current_player = NextSeat<N>(state.current_player);
       if (state.current_player == state.attack_player) {
         state.phase = GameState::Phase::BonusReceive;
       }
+      state.hash ^= scalar_hash ^ ScalarHash(state);
       return true;
     }
 
-    if (action.type != Action::Type::Defend || action.hand_index < 0 ||
-        action.hand_index >= static_cast<int>(hand.size())) {
-      return false;
-    }
-
-    if (!CanDefendWith(state.attack_tile->kind, hand[action.hand_index].kind)) {
+    if (action.type != Action::Type::Defend || hand.Count(action.tile) == 0 ||
+        !CanDefendWith(state.attack_tile->kind, action.tile)) {
       return false;
     }
 
-    remove_from_hand(action.hand_index);
+    RemoveTile(state, action.player, action.tile);
     state.attack_tile.reset();
+    state.revealed.Add(action.tile);
     state.attack_player = action.player;
     state.phase = GameState::Phase::Attack;
     state.current_player = action.player;
+    CheckFinished(state, action.player);
+    state.hash ^= scalar_hash ^ ScalarHash(state);
     return true;
   }
 
   return false;
 }
 
+void Undo(GameState& state, const UndoRecord& undo) {
+  if (undo.removed >= 0) {
+    state.hands[undo.player].Add(static_cast<TileKind>(undo.removed));
+    if (!undo.bonus) {
+      state.revealed.Remove(static_cast<TileKind>(undo.removed));
+    }
+  }
+  if (undo.bonus) {
+    state.bonus_discards[undo.player] -= 1;
+  }
+  state.phase = undo.phase;
+  state.finished = undo.finished;
+  state.attack_tile = undo.attack_tile;
+  state.current_player = undo.current_player;
+  state.attack_player = undo.attack_player;
+  state.winner = undo.winner;
+  state.hash = undo.hash;
+}
+
+std::optional<TileKind> ParseScoreLabel(const std::string& token) {
+  if (token.size() == 1 && token[0] >= '1' && token[0] <= '8') {
+    return static_cast<TileKind>(token[0] - '1');
+  }
+  if (token == "T" || token == "t") return TileKind::Tiger;
+  if (token == "D" || token == "d") return TileKind::Dragon;
+  return std::nullopt;
+}
+
+std::string TrimSpace(const std::string& input) {
+  const size_t start = input.find_first_not_of(" \t\r\n");
+  if (start == std::string::npos) {
+    return "";
+  }
+  const size_t end = input.find_last_not_of(" \t\r\n");
+  return input.substr(start, end - start + 1);
+}
+
+}  // namespace
+
+uint64_t ComputeHash(const GameState& state) {
+  return WithPlayerCount(
+      state.players, [&state](auto n) { return HashState<n()>(state); },
+      [&state] { return HashState<kMaxPlayers>(state); });
+}
+
+Action ActionFromCode(const GameState& state, uint8_t code) {
+  return CodeToAction(state, code);
+}
+
+std::vector<Tile> BuildDeck() {
+  const std::array<Tile, kDeckSize> deck = BuildDeckArray();
+  return std::vector<Tile>(deck.begin(), deck.end());
+}
+
+GameState CreateInitialState(const GameConfig& config) {
+  GameState state;
+  state.players = config.players;
+  WithPlayerCount(
+      config.players, [&](auto n) { Deal<n()>(config, state); }, [] {});
+  return state;
+}
+
+std::vector<Action> GenerateLegalActions(const GameState& state) {
+  std::vector<Action> actions;
+  if (state.finished) {
+    return actions;
+  }
+
+  const int player = state.current_player;
+  const Hand& hand = state.hands[player];
+  const int hand_size = hand.Size();
+
+  if (state.phase == GameState::Phase::Attack) {
+    for (int i = 0; i < hand_size; ++i) {
+      actions.push_back(Action{Action::Type::Attack, player, i, hand.KindAt(i)});
+    }
+    return actions;
+  }
+
+  if (state.phase == GameState::Phase::BonusReceive) {
+    for (int i = 0; i < hand_size; ++i) {
+      actions.push_back(Action{Action::Type::BonusReceive, player, i, hand.KindAt(i)});
+    }
+    return actions;
+  }
+
+  if (state.phase == GameState::Phase::Defend) {
+    if (!state.attack_tile.has_value()) {
+      return actions;
+    }
+
+    int index = 0;
+    for (int kind = 0; kind < kTileKinds; ++kind) {
+      const int count = hand.Count(static_cast<TileKind>(kind));
+      if (CanDefendWith(state.attack_tile->kind, static_cast<TileKind>(kind))) {
+        for (int i = 0; i < count; ++i) {
+          actions.push_back(
+              Action{Action::Type::Defend, player, index + i, static_cast<TileKind>(kind)});
+        }
+      }
+      index += count;
+    }
+
+    actions.push_back(Action{Action::Type::Pass, player, -1});
+    return actions;
+  }
+
+  return actions;
+}
+
+uint16_t LegalTileMask(const GameState& state) {
+  return TileMask(state);
+}
+
+uint16_t LegalCodeMask(const GameState& state) {
+  return CodeMask(state);
+}
+
+int GenerateLegalActions(const GameState& state, ActionList* out) {
+  return ListActions(state, out);
+}
+
+bool ApplyAction(GameState& state, const Action& action) {
+  return ApplyAction(state, action, nullptr);
+}
+
+bool ApplyAction(GameState& state, const Action& action, UndoRecord* undo) {
+  return WithPlayerCount(
+      state.players, [&](auto n) { return Apply<n()>(state, action, undo); }, [] { return false; });
+}
+
+void UndoAction(GameState& state, const UndoRecord& undo) {
+  Undo(state, undo);
+}
+
 std::string ToString(TileKind kind) {
   switch (kind) {
     case TileKind::Num1:
@@ -245,4 +492,147 @@ std::string ToString(TileKind kind) {
   return "?";
 }
 
+ScoreTable DefaultScoreTable() {
+  ScoreTable table{};
+  for (TileKind kind : {TileKind::Num8, TileKind::Num7}) {
+    table[static_cast<int>(kind)] = ScoreRule{4, true};
+  }
+  for (TileKind kind : {TileKind::Num6, TileKind::Num5, TileKind::Num4}) {
+    table[static_cast<int>(kind)] = ScoreRule{3, true};
+  }
+  for (TileKind kind : {TileKind::Num3, TileKind::Num2}) {
+    table[static_cast<int>(kind)] = ScoreRule{2, true};
+  }
+  table[static_cast<int>(TileKind::Num1)] = ScoreRule{10, false};
+  table[static_cast<int>(TileKind::Tiger)] = ScoreRule{1, false};
+  table[static_cast<int>(TileKind::Dragon)] = ScoreRule{1, false};
+  return table;
+}
+
+bool ParseScoreTable(const std::string& text, ScoreTable* table) {
+  std::array<bool, kTileKinds> set{};
+  std::istringstream lines(text);
+  std::string line;
+  while (std::getline(lines, line)) {
+    const size_t comment = line.find('#');
+    if (comment != std::string::npos) {
+      line = line.substr(0, comment);
+    }
+    line = TrimSpace(line);
+    if (line.empty()) {
+      continue;
+    }
+    const size_t colon = line.find(':');
+    if (colon == std::string::npos) {
+      return false;
+    }
+    const std::string left = line.substr(0, colon);
+    std::string right = TrimSpace(line.substr(colon + 1));
+    ScoreRule rule;
+    const size_t bonus_pos = right.find("+bonus");
+    if (bonus_pos != std::string::npos) {
+      rule.add_bonus = true;
+      right = TrimSpace(right.substr(0, bonus_pos));
+    }
+    try {
+      rule.base = std::stoi(right);
+    } catch (const std::exception&) {
+      return false;
+    }
+    std::istringstream tokens(left);
+    std::string token;
+    bool any = false;
+    while (std::getline(tokens, token, ',')) {
+      token = TrimSpace(token);
+      if (token.empty()) {
+        continue;
+      }
+      const auto kind = ParseScoreLabel(token);
+      if (!kind.has_value()) {
+        return false;
+      }
+      (*table)[static_cast<int>(kind.value())] = rule;
+      set[static_cast<int>(kind.value())] = true;
+      any = true;
+    }
+    if (!any) {
+      return false;
+    }
+  }
+  for (bool assigned : set) {
+    if (!assigned) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int ScoreForTile(const ScoreTable& table, TileKind kind, int bonus_discards) {
+  const ScoreRule& rule = table[static_cast<int>(kind)];
+  return rule.base + (rule.add_bonus ? bonus_discards : 0);
+}
+
+GameConfig RoundConfig(const MatchConfig& config, int round_index, int start_player) {
+  GameConfig round;
+  round.players = config.players;
+  round.seed = config.seed;
+  round.rng = GameConfig::Rng::Philox;
+  round.deal_index = static_cast<uint64_t>(round_index);
+  round.start_player = start_player;
+  return round;
+}
+
+MatchState CreateMatch(const MatchConfig& config) {
+  MatchState match;
+  match.config = config;
+  match.start_player = config.first_start_player;
+  match.round = CreateInitialState(RoundConfig(config, 0, match.start_player));
+  return match;
+}
+
+bool ApplyMatchAction(MatchState& match, const Action& action, RoundResult* result) {
+  if (match.finished || !ApplyAction(match.round, action)) {
+    return false;
+  }
+  if (result != nullptr) {
+    result->winner = -1;
+  }
+  if (!match.round.finished) {
+    return true;
+  }
+
+  const int winner = match.round.winner;
+  const int bonus = match.round.bonus_discards[winner];
+  const int points = ScoreForTile(match.config.score_table, action.tile, bonus);
+  match.scores[winner] += points;
+  ++match.round_index;
+  if (result != nullptr) {
+    result->winner = winner;
+    result->last_tile = action.tile;
+    result->bonus_discards = bonus;
+    result->points = points;
+    result->final_state = match.round;
+  }
+
+  if (match.scores[winner] >= match.config.target_score) {
+    match.finished = true;
+    match.winner = winner;
+    return true;
+  }
+  match.start_player = (match.start_player + 1) % match.config.players;
+  match.round = CreateInitialState(RoundConfig(match.config, match.round_index, match.start_player));
+  return true;
+}
+
+std::vector<Tile> HandTiles(const Hand& hand) {
+  std::vector<Tile> tiles;
+  tiles.reserve(hand.Size());
+  for (int kind = 0; kind < kTileKinds; ++kind) {
+    for (int i = hand.Count(static_cast<TileKind>(kind)); i > 0; --i) {
+      tiles.push_back(Tile{static_cast<TileKind>(kind)});
+    }
+  }
+  return tiles;
+}
+
 }  // namespace tigerdragon
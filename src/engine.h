@@ -1,9 +1,11 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <optional>
 #include <random>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 namespace tigerdragon {
@@ -21,10 +23,85 @@ enum class TileKind : uint8_t {
   Dragon,
 };
 
+constexpr int kTileKinds = static_cast<int>(TileKind::Dragon) + 1;
+constexpr int kMaxPlayers = 5;
+constexpr int kDeckSize = 38;
+
+// Tiles dealt to each player before the start player's extra draw; 0 for
+// unsupported player counts.
+constexpr int HandSizeForPlayers(int players) {
+  switch (players) {
+    case 2:
+      return 12;
+    case 3:
+      return 11;
+    case 4:
+      return 9;
+    case 5:
+      return 7;
+    default:
+      return 0;
+  }
+}
+
 struct Tile {
   TileKind kind;
 };
 
+// Tile counts per kind, packed 4 bits per TileKind (at most 8 of a kind).
+// Tiles of the same kind are interchangeable, so a hand is a multiset and
+// hand_index refers to the kind-sorted order (see HandTiles).
+struct Hand {
+  uint64_t counts = 0;
+
+  int Count(TileKind kind) const {
+    return static_cast<int>((counts >> Shift(kind)) & 0xF);
+  }
+
+  int Size() const { return SumCounts(counts); }
+
+  // Tiles of kinds below `kind`: the first hand_index of that kind.
+  int CountBelow(TileKind kind) const { return SumCounts(counts & ((uint64_t{1} << Shift(kind)) - 1)); }
+
+  bool Empty() const { return counts == 0; }
+
+  void Add(TileKind kind, int count = 1) { counts += static_cast<uint64_t>(count) << Shift(kind); }
+
+  void Remove(TileKind kind) { counts -= uint64_t{1} << Shift(kind); }
+
+  // Bit k set when the hand holds at least one tile of kind k.
+  uint16_t KindMask() const {
+    uint64_t bits = counts | (counts >> 1) | (counts >> 2) | (counts >> 3);
+    bits &= 0x1111111111ULL;
+    bits = (bits | (bits >> 3)) & 0x0303030303ULL;
+    bits = (bits | (bits >> 6)) & 0x000F000F000FULL;
+    bits = (bits | (bits >> 12)) & 0x3000000FFULL;
+    bits = (bits | (bits >> 24)) & 0x3FFULL;
+    return static_cast<uint16_t>(bits);
+  }
+
+  TileKind KindAt(int index) const {
+    for (int kind = 0; kind < kTileKinds; ++kind) {
+      index -= Count(static_cast<TileKind>(kind));
+      if (index < 0) {
+        return static_cast<TileKind>(kind);
+      }
+    }
+    return TileKind::Dragon;
+  }
+
+  bool operator==(const Hand& other) const { return counts == other.counts; }
+  bool operator!=(const Hand& other) const { return counts != other.counts; }
+
+ private:
+  static int Shift(TileKind kind) { return static_cast<int>(kind) * 4; }
+
+  static int SumCounts(uint64_t packed) {
+    uint64_t bytes = (packed & 0x0F0F0F0F0F0F0F0FULL) + ((packed >> 4) & 0x0F0F0F0F0F0F0F0FULL);
+    return static_cast<int>((bytes * 0x0101010101010101ULL) >> 56);
+  }
+};
+
 struct Action {
   enum class Type : uint8_t {
     Attack,
@@ -34,12 +111,70 @@ struct Action {
   } type;
 
   int player = 0;
+  // Position of the tile in the kind-sorted hand, or -1 to leave it out.
+  // ApplyAction rejects an index that does not hold `tile`.
   int hand_index = -1;
+  // The tile played; ApplyAction acts on this.
+  TileKind tile = TileKind::Num1;
+};
+
+// Fixed-capacity move list: one move per playable tile kind plus Pass.
+constexpr int kMaxLegalActions = kTileKinds + 1;
+
+struct ActionList {
+  std::array<Action, kMaxLegalActions> actions;
+  int size = 0;
+
+  const Action* begin() const { return actions.data(); }
+  const Action* end() const { return actions.data() + size; }
+  const Action& operator[](int index) const { return actions[index]; }
+  bool empty() const { return size == 0; }
 };
 
+// Tiles of each kind in the 38-tile set: n copies of number n, one Tiger,
+// one Dragon.
+constexpr int DeckCount(TileKind kind) {
+  return kind <= TileKind::Num8 ? static_cast<int>(kind) + 1 : 1;
+}
+
+constexpr uint16_t KindBit(TileKind kind) {
+  return static_cast<uint16_t>(1u << static_cast<int>(kind));
+}
+
+// Tiles that can answer an attack of each kind: the same number, plus Tiger
+// for even numbers and Dragon for odd numbers. Tiger and Dragon attacks
+// cannot be defended.
+constexpr std::array<uint16_t, kTileKinds> BuildDefendMasks() {
+  std::array<uint16_t, kTileKinds> masks{};
+  for (int kind = 0; kind <= static_cast<int>(TileKind::Num8); ++kind) {
+    const bool even = (kind + 1) % 2 == 0;
+    masks[kind] = static_cast<uint16_t>((1u << kind) |
+                                        KindBit(even ? TileKind::Tiger : TileKind::Dragon));
+  }
+  return masks;
+}
+
+inline constexpr std::array<uint16_t, kTileKinds> kDefendMasks = BuildDefendMasks();
+
+constexpr uint16_t DefendMask(TileKind attack) {
+  return kDefendMasks[static_cast<int>(attack)];
+}
+
 struct GameConfig {
+  enum class Rng : uint8_t {
+    // std::mt19937 seeded with `seed`; reproduces historical deals.
+    Mt19937,
+    // Philox keyed by `seed` with counter `deal_index`: deal k of a seed is
+    // computed directly, without generating deals 0..k-1.
+    Philox,
+  };
+
   int players = 2;
   uint32_t seed = 0;
+  Rng rng = Rng::Mt19937;
+  uint64_t deal_index = 0;
+  // Holds the start-player marker: draws the extra tile and attacks first.
+  int start_player = 0;
 };
 
 struct GameState {
@@ -50,26 +185,148 @@ struct GameState {
     Finished,
   } phase = Phase::Attack;
 
+  // Small fields first to keep the state compact.
+  bool finished = false;
+  std::optional<Tile> attack_tile;
+
   int players = 0;
   int current_player = 0;
   int attack_player = -1;
-  std::optional<Tile> attack_tile;
+  int winner = -1;
+
+  std::array<int, kMaxPlayers> bonus_discards{};
+  std::array<Hand, kMaxPlayers> hands{};
+  // Attack and defend tiles played face up this round (bonus discards are
+  // face down and not included). Not part of the hash.
+  Hand revealed;
+
+  // Zobrist key over hands, phase, current/attack player, attack tile and
+  // bonus counts. Kept up to date by ApplyAction/UndoAction.
+  uint64_t hash = 0;
+};
 
-  std::vector<std::vector<Tile>> hands;
-  std::vector<int> bonus_discards;
+static_assert(std::is_trivially_copyable_v<GameState>, "GameState must stay copyable by memcpy");
 
+// Everything ApplyAction changes, so UndoAction can restore the previous
+// state exactly. The removed tile's position is its kind, since hands are
+// kept in kind-sorted order.
+struct UndoRecord {
+  GameState::Phase phase = GameState::Phase::Attack;
   bool finished = false;
-  int winner = -1;
+  std::optional<Tile> attack_tile;
+  int8_t player = -1;
+  int8_t current_player = 0;
+  int8_t attack_player = -1;
+  int8_t winner = -1;
+  int8_t removed = -1;  // TileKind taken from `player`'s hand, -1 for Pass.
+  bool bonus = false;   // bonus_discards[player] was incremented.
+  uint64_t hash = 0;
 };
 
+// Compact move code shared by the search tables and record formats: the
+// tile kind, or kPassCode. The action type follows from the phase.
+constexpr uint8_t kPassCode = kTileKinds;
+
+inline uint8_t ActionCode(const Action& action) {
+  return action.type == Action::Type::Pass ? kPassCode : static_cast<uint8_t>(action.tile);
+}
+
+Action ActionFromCode(const GameState& state, uint8_t code);
+
 std::vector<Tile> BuildDeck();
 
 GameState CreateInitialState(const GameConfig& config);
 
+// One Action per hand tile (duplicates included). Kept for callers that
+// enumerate individual tiles; search and sampling should use the overloads
+// below.
 std::vector<Action> GenerateLegalActions(const GameState& state);
 
+// Fills `out` with at most one move per tile kind, plus Pass while defending.
+// Returns the number of moves.
+int GenerateLegalActions(const GameState& state, ActionList* out);
+
+// Kinds the current player may play now. Pass is legal iff the phase is
+// Defend.
+uint16_t LegalTileMask(const GameState& state);
+
+// LegalTileMask plus bit kPassCode when Pass is legal: one bit per move code.
+uint16_t LegalCodeMask(const GameState& state);
+
+// Recomputes GameState::hash from scratch.
+uint64_t ComputeHash(const GameState& state);
+
 bool ApplyAction(GameState& state, const Action& action);
 
+// As above; on success also fills `undo` for a later UndoAction.
+bool ApplyAction(GameState& state, const Action& action, UndoRecord* undo);
+
+// Reverts the ApplyAction that produced `undo`. Records must be undone in
+// reverse order of application.
+void UndoAction(GameState& state, const UndoRecord& undo);
+
 std::string ToString(TileKind kind);
 
+// Scoring for a round win by the tile that emptied the hand (the
+// battlefield card). Rules with add_bonus also pay the winner's bonus
+// discard count.
+struct ScoreRule {
+  int base = 0;
+  bool add_bonus = false;
+};
+
+using ScoreTable = std::array<ScoreRule, kTileKinds>;
+
+// The table in server/score_rules.md.
+ScoreTable DefaultScoreTable();
+
+// Parses the score_rules.md format ("8,7:4+bonus" lines, '#' comments).
+// Every tile kind must be assigned.
+bool ParseScoreTable(const std::string& text, ScoreTable* table);
+
+int ScoreForTile(const ScoreTable& table, TileKind kind, int bonus_discards);
+
+struct MatchConfig {
+  int players = 2;
+  // Round r is dealt from Philox(seed, deal_index = r).
+  uint32_t seed = 0;
+  int first_start_player = 0;
+  int target_score = 10;
+  ScoreTable score_table = DefaultScoreTable();
+};
+
+struct RoundResult {
+  int winner = -1;  // -1 when the action did not end a round.
+  TileKind last_tile = TileKind::Num1;
+  int bonus_discards = 0;
+  int points = 0;
+  GameState final_state;
+};
+
+// A whole match: rounds are played until someone reaches target_score. The
+// start-player marker passes to the next seat (the attacker's left) after
+// every round.
+struct MatchState {
+  MatchConfig config;
+  GameState round;
+  int round_index = 0;  // Rounds completed so far.
+  int start_player = 0;
+  std::array<int, kMaxPlayers> scores{};
+  bool finished = false;
+  int winner = -1;
+};
+
+GameConfig RoundConfig(const MatchConfig& config, int round_index, int start_player);
+
+MatchState CreateMatch(const MatchConfig& config);
+
+// Applies `action` to the current round. When it ends the round the winner
+// is scored and, unless the match is over, the next round is dealt. `result`
+// (optional) describes the finished round, or has winner -1.
+bool ApplyMatchAction(MatchState& match, const Action& action, RoundResult* result);
+
+// Expands a hand into kind-sorted tiles, for callers that still work with
+// per-tile lists (server payloads, debug rendering).
+std::vector<Tile> HandTiles(const Hand& hand);
+
 }  // namespace tigerdragon
@@ -0,0 +1,341 @@
+#include "engine.h"
+#include "protocol.h"
+#include "rng.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using tigerdragon::Action;
+using tigerdragon::ActionList;
+using tigerdragon::GameConfig;
+using tigerdragon::GameState;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions {
+  int repetitions = 15;
+  double min_rep_ms = 20.0;
+  std::string filter;
+  std::string out_path;
+  std::string baseline_path;
+  double threshold = 0.10;
+  int cpu = 0;
+};
+
+struct BenchResult {
+  std::string name;
+  double median_ns = 0.0;
+  double p99_ns = 0.0;
+  int repetitions = 0;
+};
+
+// Keeps benchmark results observable so the work is not optimised away.
+volatile uint64_t g_sink = 0;
+
+void PinThread(int cpu) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+  (void)cpu;
+#endif
+}
+
+double Percentile(std::vector<double> values, double fraction) {
+  std::sort(values.begin(), values.end());
+  const size_t index = static_cast<size_t>(fraction * (values.size() - 1) + 0.5);
+  return values[std::min(index, values.size() - 1)];
+}
+
+// `body(n)` runs n operations. The batch size is calibrated so one
+// repetition takes at least min_rep_ms, then one warmup repetition is
+// discarded before the timed ones.
+BenchResult Measure(const BenchOptions& options, const std::string& name,
+                    const std::function<void(int64_t)>& body) {
+  int64_t batch = 1;
+  while (true) {
+    const auto start = Clock::now();
+    body(batch);
+    const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    if (ms >= options.min_rep_ms || batch >= (int64_t{1} << 40)) {
+      break;
+    }
+    batch *= ms < options.min_rep_ms / 10 ? 10 : 2;
+  }
+
+  body(batch);
+  std::vector<double> samples;
+  for (int rep = 0; rep < options.repetitions; ++rep) {
+    const auto start = Clock::now();
+    body(batch);
+    samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count() / batch);
+  }
+
+  BenchResult result;
+  result.name = name;
+  result.median_ns = Percentile(samples, 0.5);
+  result.p99_ns = Percentile(samples, 0.99);
+  result.repetitions = options.repetitions;
+  return result;
+}
+
+// Reachable states from random play, bucketed by phase.
+std::map<GameState::Phase, std::vector<GameState>> SamplePositions(int count) {
+  std::map<GameState::Phase, std::vector<GameState>> positions;
+  tigerdragon::PhiloxEngine rng(7, 0);
+  for (uint64_t game = 0; static_cast<int>(positions[GameState::Phase::BonusReceive].size()) < count; ++game) {
+    GameConfig config;
+    config.players = 2 + static_cast<int>(game % 4);
+    config.seed = 7;
+    config.rng = GameConfig::Rng::Philox;
+    config.deal_index = game;
+    GameState state = tigerdragon::CreateInitialState(config);
+    while (!state.finished) {
+      auto& bucket = positions[state.phase];
+      if (static_cast<int>(bucket.size()) < count) {
+        bucket.push_back(state);
+      }
+      ActionList actions;
+      tigerdragon::GenerateLegalActions(state, &actions);
+      tigerdragon::ApplyAction(state, actions[rng.Below(static_cast<uint32_t>(actions.size))]);
+    }
+  }
+  return positions;
+}
+
+std::vector<BenchResult> RunBenchmarks(const BenchOptions& options) {
+  std::vector<BenchResult> results;
+  auto run = [&](const std::string& name, const std::function<void(int64_t)>& body) {
+    if (options.filter.empty() || name.find(options.filter) != std::string::npos) {
+      results.push_back(Measure(options, name, body));
+      std::cerr << name << ": " << results.back().median_ns << " ns\n";
+    }
+  };
+
+  run("BuildDeck", [](int64_t n) {
+    for (int64_t i = 0; i < n; ++i) {
+      g_sink = g_sink + tigerdragon::BuildDeck().size();
+    }
+  });
+
+  for (GameConfig::Rng kind : {GameConfig::Rng::Mt19937, GameConfig::Rng::Philox}) {
+    const std::string label = kind == GameConfig::Rng::Philox ? "Philox" : "Mt19937";
+    run("CreateInitialState/" + label, [kind](int64_t n) {
+      GameConfig config;
+      config.players = 4;
+      config.rng = kind;
+      for (int64_t i = 0; i < n; ++i) {
+        config.seed = static_cast<uint32_t>(i);
+        config.deal_index = static_cast<uint64_t>(i);
+        g_sink = g_sink + tigerdragon::CreateInitialState(config).hash;
+      }
+    });
+  }
+
+  const auto positions = SamplePositions(1024);
+  const std::pair<GameState::Phase, const char*> phases[] = {
+      {GameState::Phase::Attack, "Attack"},
+      {GameState::Phase::Defend, "Defend"},
+      {GameState::Phase::BonusReceive, "BonusReceive"},
+  };
+  for (const auto& [phase, label] : phases) {
+    const std::vector<GameState>& states = positions.at(phase);
+    run(std::string("GenerateLegalActions/") + label, [&states](int64_t n) {
+      ActionList actions;
+      for (int64_t i = 0; i < n; ++i) {
+        g_sink = g_sink + tigerdragon::GenerateLegalActions(states[i % states.size()], &actions);
+      }
+    });
+    run(std::string("GenerateLegalActions/vector/") + label, [&states](int64_t n) {
+      for (int64_t i = 0; i < n; ++i) {
+        g_sink = g_sink + tigerdragon::GenerateLegalActions(states[i % states.size()]).size();
+      }
+    });
+  }
+
+  std::vector<std::pair<GameState, Action>> moves;
+  for (const auto& [phase, label] : phases) {
+    for (const GameState& state : positions.at(phase)) {
+      ActionList actions;
+      tigerdragon::GenerateLegalActions(state, &actions);
+      moves.emplace_back(state, actions[static_cast<int>(moves.size() % actions.size)]);
+    }
+  }
+  run("ApplyAction+UndoAction", [&moves](int64_t n) {
+    for (int64_t i = 0; i < n; ++i) {
+      auto& [state, action] = moves[i % moves.size()];
+      tigerdragon::UndoRecord undo;
+      tigerdragon::ApplyAction(state, action, &undo);
+      g_sink = g_sink + state.hash;
+      tigerdragon::UndoAction(state, undo);
+    }
+  });
+
+  for (int players = 2; players <= tigerdragon::kMaxPlayers; ++players) {
+    run("Playout/" + std::to_string(players) + "p", [players](int64_t n) {
+      tigerdragon::PhiloxEngine rng(11, static_cast<uint64_t>(players));
+      GameConfig config;
+      config.players = players;
+      config.rng = GameConfig::Rng::Philox;
+      for (int64_t i = 0; i < n; ++i) {
+        config.deal_index = static_cast<uint64_t>(i);
+        GameState state = tigerdragon::CreateInitialState(config);
+        while (!state.finished) {
+          const uint16_t legal = tigerdragon::LegalCodeMask(state);
+          uint32_t pick = rng.Below(static_cast<uint32_t>(__builtin_popcount(legal)));
+          uint16_t bits = legal;
+          for (; pick > 0; --pick) {
+            bits &= bits - 1;
+          }
+          const uint8_t code = static_cast<uint8_t>(__builtin_ctz(bits));
+          tigerdragon::ApplyAction(state, tigerdragon::ActionFromCode(state, code));
+        }
+        g_sink = g_sink + state.winner;
+      }
+    });
+  }
+
+  tigerdragon::MatchConfig match_config;
+  match_config.players = 4;
+  const tigerdragon::MatchState match = tigerdragon::CreateMatch(match_config);
+  run("Protocol/BuildStateMessage", [&match](int64_t n) {
+    for (int64_t i = 0; i < n; ++i) {
+      g_sink = g_sink + tigerdragon::protocol::BuildStateMessage("room1", static_cast<int>(i), match,
+                                                                 match.round.current_player).size();
+    }
+  });
+  const std::string action_message = "{\"type\":\"action\",\"room_id\":\"room1\",\"choice\":\" 5 \"}";
+  run("Protocol/ParseAction", [&match, &action_message](int64_t n) {
+    for (int64_t i = 0; i < n; ++i) {
+      const auto type = tigerdragon::protocol::ExtractString(action_message, "type");
+      const auto choice = tigerdragon::protocol::ExtractString(action_message, "choice");
+      const auto action = tigerdragon::protocol::ParseChoice(match.round, choice.value_or(""));
+      g_sink = g_sink + type->size() + (action.has_value() ? 1 : 0);
+    }
+  });
+
+  return results;
+}
+
+std::string ToJson(const std::vector<BenchResult>& results) {
+  std::ostringstream out;
+  out << "{\n  \"benchmarks\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BenchResult& result = results[i];
+    out << "    {\"name\": \"" << result.name << "\", \"median_ns\": " << result.median_ns
+        << ", \"p99_ns\": " << result.p99_ns << ", \"repetitions\": " << result.repetitions << "}"
+        << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+  return out.str();
+}
+
+// Reads name -> median_ns from a file written by ToJson.
+bool LoadBaseline(const std::string& path, std::map<std::string, double>* medians) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    return false;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    const auto name = tigerdragon::protocol::ExtractString(line, "name");
+    const size_t pos = line.find("\"median_ns\":");
+    if (name.has_value() && pos != std::string::npos) {
+      (*medians)[name.value()] = std::strtod(line.c_str() + pos + 12, nullptr);
+    }
+  }
+  return true;
+}
+
+bool ParseOptions(int argc, char** argv, BenchOptions* options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const char* value = argv[++i];
+    if (arg == "--repetitions") {
+      options->repetitions = std::atoi(value);
+    } else if (arg == "--min-rep-ms") {
+      options->min_rep_ms = std::atof(value);
+    } else if (arg == "--filter") {
+      options->filter = value;
+    } else if (arg == "--out") {
+      options->out_path = value;
+    } else if (arg == "--baseline") {
+      options->baseline_path = value;
+    } else if (arg == "--threshold") {
+      options->threshold = std::atof(value);
+    } else if (arg == "--cpu") {
+      options->cpu = std::atoi(value);
+    } else {
+      return false;
+    }
+  }
+  return options->repetitions > 0 && options->min_rep_ms > 0.0 && options->threshold >= 0.0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  BenchOptions options;
+  if (!ParseOptions(argc, argv, &options)) {
+    std::cerr << "Usage: engine_bench [--repetitions N] [--min-rep-ms N] [--filter SUBSTR] [--cpu N]"
+                 " [--out FILE] [--baseline FILE] [--threshold 0.10]\n";
+    return 1;
+  }
+  PinThread(options.cpu);
+
+  const std::vector<BenchResult> results = RunBenchmarks(options);
+  const std::string json = ToJson(results);
+  if (options.out_path.empty()) {
+    std::cout << json;
+  } else {
+    std::ofstream(options.out_path) << json;
+  }
+
+  if (options.baseline_path.empty()) {
+    return 0;
+  }
+  std::map<std::string, double> baseline;
+  if (!LoadBaseline(options.baseline_path, &baseline)) {
+    std::cerr << "Failed to read baseline " << options.baseline_path << "\n";
+    return 1;
+  }
+  int regressions = 0;
+  for (const BenchResult& result : results) {
+    const auto it = baseline.find(result.name);
+    if (it == baseline.end() || it->second <= 0.0) {
+      continue;
+    }
+    const double change = result.median_ns / it->second - 1.0;
+    if (change > options.threshold) {
+      std::cerr << "REGRESSION " << result.name << ": " << it->second << " ns -> " << result.median_ns
+                << " ns (+" << change * 100.0 << "%)\n";
+      ++regressions;
+    }
+  }
+  if (regressions > 0) {
+    std::cerr << regressions << " benchmark(s) regressed more than " << options.threshold * 100.0 << "%\n";
+    return 2;
+  }
+  std::cerr << "No regressions against " << options.baseline_path << "\n";
+  return 0;
+}
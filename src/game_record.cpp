@@ -0,0 +1,246 @@
+#include "game_record.h"
+
+#include <cstring>
+
+#include "work_stealing_pool.h"
+
+namespace tigerdragon {
+
+namespace {
+
+constexpr char kMagic[4] = {'T', 'D', 'G', 'R'};
+constexpr uint8_t kVersion = 2;
+constexpr size_t kHeaderBytes = 4 + 4 + 4 + 8 + 4 + 2 + 2;
+// hands (8 each), revealed (8), bonus discards (1 each), phase, current
+// player, attack player, attack tile.
+constexpr size_t kCheckpointBytes = kMaxPlayers * 8 + 8 + kMaxPlayers + 4;
+constexpr uint8_t kNoAttackTile = 0xFF;
+
+void PutLe(std::vector<uint8_t>* out, uint64_t value, int bytes) {
+  for (int i = 0; i < bytes; ++i) {
+    out->push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+uint64_t GetLe(const uint8_t* data, int bytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < bytes; ++i) {
+    value |= static_cast<uint64_t>(data[i]) << (8 * i);
+  }
+  return value;
+}
+
+void PutCheckpoint(std::vector<uint8_t>* out, const GameState& state) {
+  for (int player = 0; player < kMaxPlayers; ++player) {
+    PutLe(out, state.hands[player].counts, 8);
+  }
+  PutLe(out, state.revealed.counts, 8);
+  for (int player = 0; player < kMaxPlayers; ++player) {
+    out->push_back(static_cast<uint8_t>(state.bonus_discards[player]));
+  }
+  out->push_back(static_cast<uint8_t>(state.phase));
+  out->push_back(static_cast<uint8_t>(state.current_player));
+  out->push_back(static_cast<uint8_t>(state.attack_player));
+  out->push_back(state.attack_tile.has_value() ? static_cast<uint8_t>(state.attack_tile->kind) : kNoAttackTile);
+}
+
+// Counts only in the kTileKinds nibbles, none above the deck's copies.
+bool ValidHand(const Hand& hand) {
+  if (hand.counts >> (4 * kTileKinds) != 0) {
+    return false;
+  }
+  for (int kind = 0; kind < kTileKinds; ++kind) {
+    if (hand.Count(static_cast<TileKind>(kind)) > DeckCount(static_cast<TileKind>(kind))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// False when a field is outside what the engine can index (a corrupt
+// record).
+bool GetCheckpoint(const uint8_t* data, int players, GameState* out) {
+  GameState& state = *out;
+  state = GameState{};
+  state.players = players;
+  for (int player = 0; player < kMaxPlayers; ++player) {
+    state.hands[player].counts = GetLe(data + 8 * player, 8);
+    if (!ValidHand(state.hands[player]) || (player >= players && !state.hands[player].Empty())) {
+      return false;
+    }
+  }
+  data += kMaxPlayers * 8;
+  state.revealed.counts = GetLe(data, 8);
+  if (!ValidHand(state.revealed)) {
+    return false;
+  }
+  data += 8;
+  // Every move takes a tile from a hand into the revealed set or a bonus
+  // count, so this total never grows and bonus counts stay within the
+  // Zobrist table on replay.
+  int tiles = state.revealed.Size();
+  for (int player = 0; player < kMaxPlayers; ++player) {
+    state.bonus_discards[player] = data[player];
+    tiles += state.hands[player].Size() + data[player];
+  }
+  if (tiles > kDeckSize) {
+    return false;
+  }
+  data += kMaxPlayers;
+  const int attack_player = static_cast<int8_t>(data[2]);
+  if (data[0] > static_cast<uint8_t>(GameState::Phase::Finished) || data[1] >= players || attack_player < -1 ||
+      attack_player >= players || (data[3] >= kTileKinds && data[3] != kNoAttackTile)) {
+    return false;
+  }
+  state.phase = static_cast<GameState::Phase>(data[0]);
+  state.current_player = data[1];
+  state.attack_player = attack_player;
+  if (data[3] != kNoAttackTile) {
+    state.attack_tile = Tile{static_cast<TileKind>(data[3])};
+  }
+  for (int player = 0; player < players; ++player) {
+    if (state.hands[player].Empty()) {
+      state.finished = true;
+      state.winner = player;
+      state.phase = GameState::Phase::Finished;
+    }
+  }
+  state.hash = ComputeHash(state);
+  return true;
+}
+
+}  // namespace
+
+GameRecordWriter::GameRecordWriter(const GameConfig& config, int checkpoint_interval)
+    : config_(config), checkpoint_interval_(checkpoint_interval > 0 ? checkpoint_interval : 64) {
+  state_ = CreateInitialState(config_);
+}
+
+bool GameRecordWriter::Apply(const Action& action) {
+  if (!ApplyAction(state_, action)) {
+    return false;
+  }
+  const uint8_t code = ActionCode(action);
+  if (ply_count_ % 2 == 0) {
+    moves_.push_back(code);
+  } else {
+    moves_.back() |= static_cast<uint8_t>(code << 4);
+  }
+  ++ply_count_;
+  if (ply_count_ % checkpoint_interval_ == 0) {
+    PutCheckpoint(&checkpoints_, state_);
+  }
+  return true;
+}
+
+std::vector<uint8_t> GameRecordWriter::Finish() const {
+  std::vector<uint8_t> out;
+  out.reserve(kHeaderBytes + moves_.size() + checkpoints_.size());
+  for (char c : kMagic) {
+    out.push_back(static_cast<uint8_t>(c));
+  }
+  out.push_back(kVersion);
+  out.push_back(static_cast<uint8_t>(config_.players));
+  out.push_back(static_cast<uint8_t>(config_.rng));
+  out.push_back(static_cast<uint8_t>(config_.start_player));
+  PutLe(&out, config_.seed, 4);
+  PutLe(&out, config_.deal_index, 8);
+  PutLe(&out, static_cast<uint64_t>(ply_count_), 4);
+  PutLe(&out, static_cast<uint64_t>(checkpoint_interval_), 2);
+  PutLe(&out, checkpoints_.size() / kCheckpointBytes, 2);
+  out.insert(out.end(), moves_.begin(), moves_.end());
+  out.insert(out.end(), checkpoints_.begin(), checkpoints_.end());
+  return out;
+}
+
+bool GameRecordView::Parse(const uint8_t* data, size_t size) {
+  if (size < kHeaderBytes || std::memcmp(data, kMagic, sizeof(kMagic)) != 0 || data[4] != kVersion) {
+    return false;
+  }
+  config_ = GameConfig{};
+  config_.players = data[5];
+  config_.rng = static_cast<GameConfig::Rng>(data[6]);
+  config_.start_player = data[7];
+  config_.seed = static_cast<uint32_t>(GetLe(data + 8, 4));
+  config_.deal_index = GetLe(data + 12, 8);
+  ply_count_ = static_cast<int>(GetLe(data + 20, 4));
+  checkpoint_interval_ = static_cast<int>(GetLe(data + 24, 2));
+  checkpoint_count_ = static_cast<int>(GetLe(data + 26, 2));
+  const size_t move_bytes = (static_cast<size_t>(ply_count_) + 1) / 2;
+  if (config_.players < 2 || config_.players > kMaxPlayers || config_.start_player >= config_.players ||
+      config_.rng > GameConfig::Rng::Philox || checkpoint_interval_ == 0 || ply_count_ < 0 ||
+      checkpoint_count_ != ply_count_ / checkpoint_interval_ ||
+      size < kHeaderBytes + move_bytes + checkpoint_count_ * kCheckpointBytes) {
+    return false;
+  }
+  moves_ = data + kHeaderBytes;
+  checkpoints_ = moves_ + move_bytes;
+  return true;
+}
+
+bool GameRecordView::StateAt(int ply, GameState* out) const {
+  if (ply < 0 || ply > ply_count_) {
+    return false;
+  }
+  const int checkpoint = ply / checkpoint_interval_;
+  if (checkpoint == 0) {
+    *out = CreateInitialState(config_);
+  } else if (!GetCheckpoint(checkpoints_ + (checkpoint - 1) * kCheckpointBytes, config_.players, out)) {
+    return false;
+  }
+  for (int i = checkpoint * checkpoint_interval_; i < ply; ++i) {
+    const uint8_t code = MoveCode(i);
+    if (code > kPassCode || !ApplyAction(*out, ActionFromCode(*out, code))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool GameRecordView::Verify() const {
+  GameState state = CreateInitialState(config_);
+  std::vector<uint8_t> expected;
+  for (int ply = 0; ply <= ply_count_; ++ply) {
+    if (ply > 0 && ply % checkpoint_interval_ == 0) {
+      expected.clear();
+      PutCheckpoint(&expected, state);
+      const uint8_t* stored = checkpoints_ + (ply / checkpoint_interval_ - 1) * kCheckpointBytes;
+      if (std::memcmp(expected.data(), stored, kCheckpointBytes) != 0) {
+        return false;
+      }
+    }
+    if (ply < ply_count_) {
+      const uint8_t code = MoveCode(ply);
+      if (code > kPassCode || !ApplyAction(state, ActionFromCode(state, code))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int64_t DecodeRecords(const std::vector<std::vector<uint8_t>>& records, GameState* finals, bool* ok,
+                      WorkStealingPool* pool) {
+  std::vector<uint8_t> decoded(records.size(), 0);
+  auto decode = [&](int64_t i, int) {
+    GameRecordView view;
+    decoded[i] = view.Parse(records[i].data(), records[i].size()) && view.StateAt(view.ply_count(), &finals[i]);
+  };
+  if (pool != nullptr) {
+    pool->ParallelFor(static_cast<int64_t>(records.size()), decode);
+  } else {
+    for (size_t i = 0; i < records.size(); ++i) {
+      decode(static_cast<int64_t>(i), 0);
+    }
+  }
+  int64_t count = 0;
+  for (size_t i = 0; i < records.size(); ++i) {
+    count += decoded[i];
+    if (ok != nullptr) {
+      ok[i] = decoded[i] != 0;
+    }
+  }
+  return count;
+}
+
+}  // namespace tigerdragon
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "engine.h"
+
+namespace tigerdragon {
+
+class WorkStealingPool;
+
+// Binary record of one round: the GameConfig it was dealt from, every move
+// as a 4-bit move code (ActionCode), and a compact state checkpoint before
+// ply N, 2N, ... so any ply is reached by replaying fewer than N moves (the
+// first N from a fresh deal of the header config).
+//
+// Layout (little endian):
+//   header   "TDGR", version u8, players u8, rng u8, start_player u8,
+//            seed u32, deal_index u64, ply_count u32, checkpoint_interval u16,
+//            checkpoint_count u16
+//   moves    (ply_count + 1) / 2 bytes, even plies in the low nibble
+//   states   checkpoint_count * kCheckpointBytes
+class GameRecordWriter {
+ public:
+  explicit GameRecordWriter(const GameConfig& config, int checkpoint_interval = 64);
+
+  // Applies `action` to the recorded game; false (and nothing recorded) if
+  // it is illegal.
+  bool Apply(const Action& action);
+
+  const GameState& state() const { return state_; }
+  int ply_count() const { return ply_count_; }
+
+  std::vector<uint8_t> Finish() const;
+
+ private:
+  GameConfig config_;
+  int checkpoint_interval_;
+  GameState state_;
+  int ply_count_ = 0;
+  std::vector<uint8_t> moves_;
+  std::vector<uint8_t> checkpoints_;
+};
+
+// Reads a record in place; the bytes must outlive the view.
+class GameRecordView {
+ public:
+  bool Parse(const uint8_t* data, size_t size);
+
+  const GameConfig& config() const { return config_; }
+  int ply_count() const { return ply_count_; }
+  uint8_t MoveCode(int ply) const { return (moves_[ply / 2] >> ((ply % 2) * 4)) & 0xF; }
+
+  // State before move `ply` (ply_count gives the final state). False if the
+  // record does not replay.
+  bool StateAt(int ply, GameState* out) const;
+
+  // Replays every move from the deal in config() and checks each
+  // checkpoint along the way.
+  bool Verify() const;
+
+ private:
+  GameConfig config_;
+  int ply_count_ = 0;
+  int checkpoint_interval_ = 0;
+  int checkpoint_count_ = 0;
+  const uint8_t* moves_ = nullptr;
+  const uint8_t* checkpoints_ = nullptr;
+};
+
+// Replays records[i] to its final state in finals[i]. Returns how many
+// replayed cleanly; ok[i] (optional) flags each one.
+int64_t DecodeRecords(const std::vector<std::vector<uint8_t>>& records, GameState* finals, bool* ok,
+                      WorkStealingPool* pool);
+
+}  // namespace tigerdragon
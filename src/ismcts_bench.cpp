@@ -0,0 +1,149 @@
+#include "determinization.h"
+#include "engine.h"
+#include "ismcts_player.h"
+#include "rng.h"
+#include "work_stealing_pool.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using tigerdragon::GameConfig;
+using tigerdragon::GameState;
+
+namespace {
+
+struct BenchOptions {
+  int players = 4;
+  int positions = 8;
+  // Random plies played from each deal before it is searched.
+  int plies = 4;
+  double ms = 100.0;
+  int max_threads = 64;
+  uint64_t seed = 42;
+};
+
+bool ParseOptions(int argc, char** argv, BenchOptions* options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const char* value = argv[++i];
+    if (arg == "--players") {
+      options->players = std::atoi(value);
+    } else if (arg == "--positions") {
+      options->positions = std::atoi(value);
+    } else if (arg == "--plies") {
+      options->plies = std::atoi(value);
+    } else if (arg == "--ms") {
+      options->ms = std::atof(value);
+    } else if (arg == "--max-threads") {
+      options->max_threads = std::atoi(value);
+    } else if (arg == "--seed") {
+      options->seed = std::strtoull(value, nullptr, 10);
+    } else {
+      return false;
+    }
+  }
+  return options->players >= 2 && options->players <= tigerdragon::kMaxPlayers &&
+         options->positions > 0 && options->plies >= 0 && options->ms > 0.0 && options->max_threads > 0;
+}
+
+// Builds a sampler for the player to move in every position and draws from
+// it until `ms` has passed; reports construction time and sampling rate.
+void BenchSampler(const std::vector<GameState>& positions, double ms, uint64_t seed) {
+  using Clock = std::chrono::steady_clock;
+  double construct_seconds = 0.0;
+  double sample_seconds = 0.0;
+  int64_t samples = 0;
+  tigerdragon::PhiloxEngine rng(seed, 0);
+  GameState sample;
+  for (const GameState& state : positions) {
+    const auto start = Clock::now();
+    const tigerdragon::DeterminizationSampler sampler(tigerdragon::MakeObservation(state, state.current_player));
+    const auto built = Clock::now();
+    construct_seconds += std::chrono::duration<double>(built - start).count();
+    if (!sampler.valid()) {
+      continue;
+    }
+    const auto deadline = built + std::chrono::duration_cast<Clock::duration>(
+                                      std::chrono::duration<double, std::milli>(ms / positions.size()));
+    auto now = built;
+    while (now < deadline) {
+      for (int i = 0; i < 256; ++i) {
+        sampler.Sample(rng, &sample);
+      }
+      samples += 256;
+      now = Clock::now();
+    }
+    sample_seconds += std::chrono::duration<double>(now - built).count();
+  }
+  std::cout << "sampler: construct_us=" << std::fixed << std::setprecision(1)
+            << construct_seconds * 1e6 / positions.size() << " samples/ms=" << std::setprecision(0)
+            << (sample_seconds > 0.0 ? samples / sample_seconds / 1000.0 : 0.0) << "\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  BenchOptions options;
+  if (!ParseOptions(argc, argv, &options)) {
+    std::cerr << "Usage: ismcts_bench [--players 2-5] [--positions N] [--plies N] [--ms N]"
+                 " [--max-threads N] [--seed N]\n";
+    return 1;
+  }
+
+  std::vector<GameState> positions;
+  for (int i = 0; i < options.positions; ++i) {
+    GameConfig config;
+    config.players = options.players;
+    config.seed = static_cast<uint32_t>(options.seed);
+    config.rng = GameConfig::Rng::Philox;
+    config.deal_index = static_cast<uint64_t>(i);
+    GameState state = tigerdragon::CreateInitialState(config);
+    tigerdragon::PhiloxEngine rng(options.seed, static_cast<uint64_t>(i));
+    tigerdragon::ActionList actions;
+    for (int ply = 0; ply < options.plies && !state.finished; ++ply) {
+      if (tigerdragon::GenerateLegalActions(state, &actions) == 0) {
+        break;
+      }
+      tigerdragon::ApplyAction(state, actions[rng.Below(static_cast<uint32_t>(actions.size))]);
+    }
+    positions.push_back(state);
+  }
+
+  BenchSampler(positions, options.ms, options.seed);
+
+  std::cout << "threads  iterations/sec  nodes/sec  speedup\n";
+  double base_rate = 0.0;
+  for (int threads = 1; threads <= options.max_threads; threads *= 2) {
+    tigerdragon::WorkStealingPool pool(threads);
+    tigerdragon::IsmctsConfig config;
+    config.max_iterations = 0;
+    config.time_limit_ms = options.ms;
+    config.seed = options.seed;
+    tigerdragon::IsmctsPlayer player(config, &pool);
+
+    for (const GameState& state : positions) {
+      tigerdragon::ActionList actions;
+      tigerdragon::GenerateLegalActions(state, &actions);
+      tigerdragon::Action action;
+      player.ChooseAction(state, actions, &action);
+    }
+
+    const tigerdragon::IsmctsStats& stats = player.total_stats();
+    const double rate = stats.IterationsPerSecond();
+    if (threads == 1) {
+      base_rate = rate;
+    }
+    std::cout << std::setw(7) << threads << std::setw(16) << std::fixed << std::setprecision(0) << rate
+              << std::setw(11) << (stats.seconds > 0 ? stats.nodes / stats.seconds : 0.0)
+              << std::setw(9) << std::setprecision(2) << (base_rate > 0 ? rate / base_rate : 0.0)
+              << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,290 @@
+#include "ismcts_player.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "determinization.h"
+#include "endgame_solver.h"
+#include "rng.h"
+#include "work_stealing_pool.h"
+
+namespace tigerdragon {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kMoveCodes = kMaxLegalActions;
+constexpr int kDeadlineCheckInterval = 16;
+
+struct Node {
+  std::array<int32_t, kMoveCodes> children;
+  int32_t visits = 0;
+  int32_t available = 0;
+  float reward = 0.0f;  // Wins for `mover`, the player whose move led here.
+  int8_t mover = -1;
+
+  Node() { children.fill(-1); }
+};
+
+struct TreeResult {
+  std::array<int64_t, kMoveCodes> root_visits{};
+  int64_t iterations = 0;
+  int64_t nodes = 0;
+};
+
+uint8_t NthCode(uint16_t mask, uint32_t n) {
+  for (; n > 0; --n) {
+    mask &= mask - 1;
+  }
+  return static_cast<uint8_t>(__builtin_ctz(mask));
+}
+
+uint8_t RandomCode(uint16_t mask, PhiloxEngine& rng) {
+  return NthCode(mask, rng.Below(static_cast<uint32_t>(__builtin_popcount(mask))));
+}
+
+EndgameConfig SolverConfig(const IsmctsConfig& config) {
+  EndgameConfig solver_config;
+  solver_config.max_nodes = config.solver_max_nodes;
+  return solver_config;
+}
+
+// The table for one tree, allocated on first use. Sized from the node
+// budget: one solve stores at most solver_max_nodes entries.
+TranspositionTable* SolverTable(const IsmctsConfig& config, std::unique_ptr<TranspositionTable>* slot) {
+  if (*slot == nullptr) {
+    size_t megabytes = config.solver_table_megabytes;
+    if (megabytes == 0) {
+      megabytes = config.solver_max_nodes > 0
+                      ? std::max<size_t>(1, (static_cast<size_t>(config.solver_max_nodes) * 64) >> 20)
+                      : 16;
+    }
+    *slot = std::make_unique<TranspositionTable>(megabytes);
+  }
+  return slot->get();
+}
+
+class SearchTree {
+ public:
+  SearchTree(const DeterminizationSampler& sampler, const IsmctsConfig& config, PhiloxEngine rng,
+             std::unique_ptr<TranspositionTable>* solver_table)
+      : sampler_(sampler), config_(config), rng_(rng), solver_table_(solver_table) {
+    nodes_.emplace_back();
+  }
+
+  void Run(int64_t max_iterations, Clock::time_point deadline, bool timed, TreeResult* result) {
+    int64_t iterations = 0;
+    while (max_iterations <= 0 || iterations < max_iterations) {
+      if (timed && iterations % kDeadlineCheckInterval == 0 && Clock::now() >= deadline) {
+        break;
+      }
+      Iterate();
+      ++iterations;
+    }
+    for (int code = 0; code < kMoveCodes; ++code) {
+      const int32_t child = nodes_[0].children[code];
+      result->root_visits[code] = child >= 0 ? nodes_[child].visits : 0;
+    }
+    result->iterations = iterations;
+    result->nodes = static_cast<int64_t>(nodes_.size());
+  }
+
+ private:
+  void Iterate() {
+    GameState state;
+    sampler_.Sample(rng_, &state);
+
+    path_.clear();
+    path_.push_back(0);
+    int32_t node = 0;
+    while (!state.finished) {
+      const uint16_t legal = LegalCodeMask(state);
+      if (legal == 0) {
+        break;
+      }
+      uint16_t untried = 0;
+      for (uint16_t bits = legal; bits != 0; bits &= bits - 1) {
+        const int code = __builtin_ctz(bits);
+        const int32_t child = nodes_[node].children[code];
+        if (child < 0) {
+          untried |= 1u << code;
+        } else {
+          ++nodes_[child].available;
+        }
+      }
+
+      if (untried != 0) {
+        const uint8_t code = RandomCode(untried, rng_);
+        const int mover = state.current_player;
+        ApplyAction(state, ActionFromCode(state, code));
+        const int32_t child = static_cast<int32_t>(nodes_.size());
+        nodes_.emplace_back();
+        nodes_[child].mover = static_cast<int8_t>(mover);
+        nodes_[child].available = 1;
+        nodes_[node].children[code] = child;
+        path_.push_back(child);
+        break;
+      }
+
+      int best_code = -1;
+      double best_score = -1.0;
+      for (uint16_t bits = legal; bits != 0; bits &= bits - 1) {
+        const int code = __builtin_ctz(bits);
+        const Node& child = nodes_[nodes_[node].children[code]];
+        const double score = child.reward / child.visits +
+                             config_.exploration * std::sqrt(std::log(child.available) / child.visits);
+        if (score > best_score) {
+          best_score = score;
+          best_code = code;
+        }
+      }
+      ApplyAction(state, ActionFromCode(state, static_cast<uint8_t>(best_code)));
+      node = nodes_[node].children[best_code];
+      path_.push_back(node);
+    }
+
+    const int winner = Playout(state);
+    for (size_t i = 1; i < path_.size(); ++i) {
+      Node& visited = nodes_[path_[i]];
+      ++visited.visits;
+      if (visited.mover == winner) {
+        visited.reward += 1.0f;
+      }
+    }
+  }
+
+  // Winner of the position from here: proven by the solver when it is small
+  // enough and the result is decisive, otherwise a random playout.
+  int Playout(GameState& state) {
+    if (config_.solver_tiles > 0 && !state.finished && TilesInHands(state) <= config_.solver_tiles) {
+      if (solver_ == nullptr) {
+        solver_ = std::make_unique<EndgameSolver>(SolverConfig(config_), SolverTable(config_, solver_table_));
+      }
+      const EndgameResult result = solver_->Solve(state);
+      if (result.winner >= 0) {
+        return result.winner;
+      }
+    }
+    for (int ply = 0; !state.finished && ply < config_.max_playout_plies; ++ply) {
+      const uint16_t legal = LegalCodeMask(state);
+      if (legal == 0) {
+        break;
+      }
+      ApplyAction(state, ActionFromCode(state, RandomCode(legal, rng_)));
+    }
+    return state.finished ? state.winner : -1;
+  }
+
+  const DeterminizationSampler& sampler_;
+  const IsmctsConfig& config_;
+  PhiloxEngine rng_;
+  std::unique_ptr<TranspositionTable>* solver_table_;
+  std::unique_ptr<EndgameSolver> solver_;
+  std::vector<Node> nodes_;
+  std::vector<int32_t> path_;
+};
+
+}  // namespace
+
+IsmctsPlayer::IsmctsPlayer(const IsmctsConfig& config, WorkStealingPool* pool)
+    : config_(config), pool_(pool) {
+  if (config_.max_iterations <= 0 && config_.time_limit_ms <= 0.0) {
+    config_.max_iterations = 1;
+  }
+}
+
+bool IsmctsPlayer::ChooseAction(const GameState& state, const ActionList& actions, Action* out_action) {
+  if (actions.empty() || out_action == nullptr) {
+    return false;
+  }
+  last_stats_ = IsmctsStats{};
+  const uint64_t decision = decisions_++;
+  if (actions.size == 1) {
+    *out_action = actions[0];
+    return true;
+  }
+
+  const DeterminizationSampler sampler(MakeObservation(state, state.current_player));
+  if (!sampler.valid()) {
+    *out_action = actions[0];
+    return true;
+  }
+
+  const int trees = config_.trees > 0 ? config_.trees : (pool_ != nullptr ? pool_->threads() : 1);
+  if (solver_tables_.size() < static_cast<size_t>(trees)) {
+    solver_tables_.resize(trees);
+  }
+  if (config_.solver_tiles > 0 && sampler.ConsistentDeals() == 1.0) {
+    PhiloxEngine rng(config_.seed, decision);
+    GameState known;
+    sampler.Sample(rng, &known);
+    if (TilesInHands(known) <= config_.solver_tiles) {
+      EndgameSolver solver(SolverConfig(config_), SolverTable(config_, &solver_tables_[0]));
+      const EndgameResult result = solver.Solve(known);
+      if (result.outcome == EndgameResult::Outcome::Win) {
+        for (const Action& action : actions) {
+          if (ActionCode(action) == ActionCode(result.best_move)) {
+            *out_action = action;
+            return true;
+          }
+        }
+      }
+    }
+  }
+
+  const bool timed = config_.time_limit_ms > 0.0;
+  const auto start = Clock::now();
+  const auto deadline =
+      start + std::chrono::duration_cast<Clock::duration>(
+                  std::chrono::duration<double, std::milli>(config_.time_limit_ms));
+  const uint64_t key = Mix64(config_.seed + 0x9E3779B97F4A7C15ULL * (decision + 1));
+
+  std::vector<TreeResult> results(trees);
+  auto search = [&](int64_t tree, int) {
+    int64_t budget = 0;
+    if (config_.max_iterations > 0) {
+      budget = config_.max_iterations / trees + (tree < config_.max_iterations % trees ? 1 : 0);
+      if (budget == 0) {
+        return;
+      }
+    }
+    SearchTree search_tree(sampler, config_, PhiloxEngine(key, static_cast<uint64_t>(tree)),
+                           &solver_tables_[tree]);
+    search_tree.Run(budget, deadline, timed, &results[tree]);
+  };
+  if (pool_ != nullptr) {
+    pool_->ParallelFor(trees, search);
+  } else {
+    for (int tree = 0; tree < trees; ++tree) {
+      search(tree, 0);
+    }
+  }
+
+  std::array<int64_t, kMoveCodes> visits{};
+  for (const TreeResult& result : results) {
+    for (int code = 0; code < kMoveCodes; ++code) {
+      visits[code] += result.root_visits[code];
+    }
+    last_stats_.iterations += result.iterations;
+    last_stats_.nodes += result.nodes;
+  }
+  last_stats_.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  total_stats_.iterations += last_stats_.iterations;
+  total_stats_.nodes += last_stats_.nodes;
+  total_stats_.seconds += last_stats_.seconds;
+
+  const Action* best = &actions[0];
+  for (const Action& action : actions) {
+    if (visits[ActionCode(action)] > visits[ActionCode(*best)]) {
+      best = &action;
+    }
+  }
+  *out_action = *best;
+  return true;
+}
+
+}  // namespace tigerdragon
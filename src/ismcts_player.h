@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "engine.h"
+#include "transposition_table.h"
+
+namespace tigerdragon {
+
+class WorkStealingPool;
+
+struct IsmctsConfig {
+  // Search stops at whichever budget runs out first; 0 disables a budget.
+  // At least one must be set.
+  int64_t max_iterations = 10000;
+  double time_limit_ms = 0.0;
+  // Independent trees per decision (root parallelism). With a pool, 0 means
+  // one tree per pool thread.
+  int trees = 0;
+  double exploration = 0.7;
+  // Random playouts give up after this many plies and score nobody.
+  int max_playout_plies = 400;
+  // Once at most this many tiles remain in hands, determinized positions
+  // are solved with EndgameSolver instead of played out (and a fully known
+  // root is solved directly). 0 disables the solver.
+  int solver_tiles = 0;
+  int64_t solver_max_nodes = 20000;
+  // Solver table per tree, allocated on first use. 0 sizes it from
+  // solver_max_nodes (16MB when that is unlimited).
+  size_t solver_table_megabytes = 0;
+  uint64_t seed = 0;
+};
+
+struct IsmctsStats {
+  int64_t iterations = 0;
+  int64_t nodes = 0;
+  double seconds = 0.0;
+
+  double IterationsPerSecond() const { return seconds > 0.0 ? iterations / seconds : 0.0; }
+};
+
+// Single-observer information-set MCTS. Every iteration samples a deal
+// consistent with what the current player can see, then walks one shared
+// tree keyed by move code, with UCB normalised by how often each move was
+// available. Trees are searched independently (one per pool worker) and
+// their root visit counts summed. Each tree index keeps its own solver
+// table across decisions, so results are reproducible for a fixed
+// iteration budget, tree count and sequence of decisions.
+class IsmctsPlayer {
+ public:
+  // `pool` is optional and must outlive the player. It must not be in use
+  // by the caller while ChooseAction runs (ParallelFor is not reentrant).
+  explicit IsmctsPlayer(const IsmctsConfig& config, WorkStealingPool* pool = nullptr);
+
+  // Only the current player's information set is used: opponents' hands in
+  // `state` are resampled, never read.
+  bool ChooseAction(const GameState& state, const ActionList& actions, Action* out_action);
+
+  const IsmctsStats& last_stats() const { return last_stats_; }
+  const IsmctsStats& total_stats() const { return total_stats_; }
+
+ private:
+  IsmctsConfig config_;
+  WorkStealingPool* pool_;
+  std::vector<std::unique_ptr<TranspositionTable>> solver_tables_;
+  uint64_t decisions_ = 0;
+  IsmctsStats last_stats_;
+  IsmctsStats total_stats_;
+};
+
+}  // namespace tigerdragon
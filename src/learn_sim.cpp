@@ -1,73 +1,318 @@
 #include "engine.h"
+#include "ismcts_player.h"
+#include "observation.h"
+#include "random_player.h"
+#include "rng.h"
+#include "trajectory_shard.h"
+#include "work_stealing_pool.h"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
-#include <random>
+#include <memory>
+#include <sstream>
+#include <string>
 #include <vector>
 
 using tigerdragon::Action;
 using tigerdragon::GameConfig;
 using tigerdragon::GameState;
 
-int main() {
-  GameConfig config;
-  config.players = 4;
-  config.seed = 42;
+namespace {
 
-  const int kMatches = 10;
-  const int kMaxTurns = 500;
+struct SimOptions {
+  int players = 4;
+  int64_t games = 10;
+  int threads = 1;
+  uint64_t seed = 42;
+  // One agent name for every seat, or a comma-separated name per seat.
+  std::string agent = "random";
+  std::vector<std::string> seat_agents;
+  int64_t ismcts_iterations = 1000;
+  double ismcts_ms = 0.0;
+  int ismcts_solver_tiles = 0;
+  int max_turns = 500;
+  bool verbose = false;
+  // Every decision is recorded to trajectory shards here when set.
+  std::string record_dir;
+  uint64_t shard_mb = 256;
+};
 
-  std::mt19937 rng(1234);
+struct GameResult {
+  int turns = 0;
+  int winner = -1;
+  // An agent returned no move or the engine rejected one.
+  bool failed = false;
+};
 
-  int total_turns = 0;
-  std::vector<int> wins(config.players, 0);
-  int no_winner = 0;
+struct alignas(64) SimStats {
+  int64_t games = 0;
+  int64_t turns = 0;
+  std::array<int64_t, tigerdragon::kMaxPlayers> wins{};
+  int64_t no_winner = 0;
+  int64_t failed = 0;
 
-  for (int match = 0; match < kMatches; ++match) {
-    GameState state = tigerdragon::CreateInitialState(config);
-    int turns = 0;
+  void Add(const GameResult& result) {
+    ++games;
+    turns += result.turns;
+    if (result.failed) {
+      ++failed;
+    } else if (result.winner >= 0) {
+      ++wins[result.winner];
+    } else {
+      ++no_winner;
+    }
+  }
 
-    while (!state.finished && turns < kMaxTurns) {
-      auto actions = tigerdragon::GenerateLegalActions(state);
-      if (actions.empty()) {
-        break;
-      }
+  void Merge(const SimStats& other) {
+    games += other.games;
+    turns += other.turns;
+    for (size_t i = 0; i < wins.size(); ++i) {
+      wins[i] += other.wins[i];
+    }
+    no_winner += other.no_winner;
+    failed += other.failed;
+  }
+};
 
-      std::uniform_int_distribution<int> dist(0, static_cast<int>(actions.size()) - 1);
-      Action action = actions[dist(rng)];
+// Agent RNG seed for (seed, game, seat). Deals use Philox counter `game`
+// directly, so any game can be replayed from its index alone.
+uint32_t AgentSeed(uint64_t seed, int64_t game, int seat) {
+  return static_cast<uint32_t>(
+      tigerdragon::Mix64(seed + 0x9E3779B97F4A7C15ULL * (static_cast<uint64_t>(game) * 8 + seat + 1)));
+}
 
-      if (!tigerdragon::ApplyAction(state, action)) {
-        std::cerr << "Invalid action\n";
-        return 1;
-      }
+class SeatAgent {
+ public:
+  SeatAgent(const SimOptions& options, const std::string& name, uint32_t seed) : random_(seed) {
+    if (name == "ismcts") {
+      tigerdragon::IsmctsConfig config;
+      config.max_iterations = options.ismcts_iterations;
+      config.time_limit_ms = options.ismcts_ms;
+      config.solver_tiles = options.ismcts_solver_tiles;
+      config.trees = 1;
+      config.seed = seed;
+      ismcts_ = std::make_unique<tigerdragon::IsmctsPlayer>(config);
+    }
+  }
 
-      if (state.hands[action.player].empty()) {
-        state.finished = true;
-        state.winner = action.player;
-        break;
-      }
+  bool ChooseAction(const GameState& state, const tigerdragon::ActionList& actions, Action* out_action) {
+    if (ismcts_ != nullptr) {
+      return ismcts_->ChooseAction(state, actions, out_action);
+    }
+    return random_.ChooseAction(actions, out_action);
+  }
+
+ private:
+  tigerdragon::RandomPlayer random_;
+  std::unique_ptr<tigerdragon::IsmctsPlayer> ismcts_;
+};
+
+// `records` (optional) receives one TrajectoryRecord per decision; a failed
+// game leaves it empty.
+GameResult PlayGame(const SimOptions& options, int64_t game,
+                    std::vector<tigerdragon::TrajectoryRecord>* records) {
+  GameConfig config;
+  config.players = options.players;
+  config.seed = static_cast<uint32_t>(options.seed);
+  config.rng = tigerdragon::GameConfig::Rng::Philox;
+  config.deal_index = static_cast<uint64_t>(game);
+  GameState state = tigerdragon::CreateInitialState(config);
 
-      ++turns;
+  std::vector<SeatAgent> agents;
+  agents.reserve(options.players);
+  for (int seat = 0; seat < options.players; ++seat) {
+    agents.emplace_back(options, options.seat_agents[seat], AgentSeed(options.seed, game, seat));
+  }
+
+  GameResult result;
+  while (!state.finished && result.turns < options.max_turns) {
+    tigerdragon::ActionList actions;
+    Action action;
+    if (tigerdragon::GenerateLegalActions(state, &actions) == 0 ||
+        !agents[state.current_player].ChooseAction(state, actions, &action)) {
+      result.failed = true;
+      break;
+    }
+    if (records != nullptr) {
+      tigerdragon::TrajectoryRecord record;
+      const tigerdragon::ObservationView view(state, state.current_player);
+      tigerdragon::EncodeObservation(view, record.features);
+      record.action = tigerdragon::ActionCode(action);
+      record.seat = static_cast<uint8_t>(state.current_player);
+      record.legal_mask = view.legal_mask();
+      record.ply = static_cast<uint16_t>(result.turns);
+      record.game = static_cast<uint64_t>(game);
+      records->push_back(record);
     }
+    if (!tigerdragon::ApplyAction(state, action)) {
+      result.failed = true;
+      break;
+    }
+    ++result.turns;
+  }
+  result.winner = state.winner;
+  if (records != nullptr && result.failed) {
+    records->clear();
+  } else if (records != nullptr) {
+    for (auto& record : *records) {
+      record.outcome = result.winner < 0 ? 0 : (record.seat == result.winner ? 1 : -1);
+    }
+  }
+  return result;
+}
 
-    total_turns += turns;
-    std::cout << "Match " << match + 1 << ": Turns=" << turns << " ";
-    if (state.winner >= 0) {
-      ++wins[state.winner];
-      std::cout << "Winner=Player " << state.winner << "\n";
+bool ParseOptions(int argc, char** argv, SimOptions* options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--verbose") {
+      options->verbose = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const char* value = argv[++i];
+    if (arg == "--players") {
+      options->players = std::atoi(value);
+    } else if (arg == "--games") {
+      options->games = std::atoll(value);
+    } else if (arg == "--threads") {
+      options->threads = std::atoi(value);
+    } else if (arg == "--seed") {
+      options->seed = std::strtoull(value, nullptr, 10);
+    } else if (arg == "--agent") {
+      options->agent = value;
+    } else if (arg == "--ismcts-iterations") {
+      options->ismcts_iterations = std::atoll(value);
+    } else if (arg == "--ismcts-ms") {
+      options->ismcts_ms = std::atof(value);
+    } else if (arg == "--ismcts-solver-tiles") {
+      options->ismcts_solver_tiles = std::atoi(value);
+    } else if (arg == "--record-dir") {
+      options->record_dir = value;
+    } else if (arg == "--shard-mb") {
+      options->shard_mb = std::strtoull(value, nullptr, 10);
+    } else if (arg == "--max-turns") {
+      options->max_turns = std::atoi(value);
     } else {
-      ++no_winner;
-      std::cout << "No winner\n";
+      return false;
     }
   }
+  if (options->players < 2 || options->players > tigerdragon::kMaxPlayers || options->games < 0) {
+    return false;
+  }
+  std::stringstream names(options->agent);
+  std::string name;
+  while (std::getline(names, name, ',')) {
+    if (name != "random" && name != "ismcts") {
+      return false;
+    }
+    options->seat_agents.push_back(name);
+  }
+  if (options->seat_agents.size() == 1) {
+    options->seat_agents.resize(options->players, options->seat_agents[0]);
+  }
+  return static_cast<int>(options->seat_agents.size()) == options->players;
+}
 
-  std::cout << "Summary: matches=" << kMatches << " avg_turns="
-            << (kMatches > 0 ? (total_turns / kMatches) : 0) << "\n";
-  for (int player = 0; player < config.players; ++player) {
-    std::cout << "Player " << player << " wins: " << wins[player] << "\n";
+}  // namespace
+
+int main(int argc, char** argv) {
+  SimOptions options;
+  if (!ParseOptions(argc, argv, &options)) {
+    std::cerr << "Usage: learn_sim [--players 2-5] [--games N] [--threads N] [--seed N]"
+                 " [--agent random|ismcts[,...]] [--ismcts-iterations N] [--ismcts-ms N]"
+                 " [--ismcts-solver-tiles N] [--max-turns N] [--record-dir DIR] [--shard-mb N]"
+                 " [--verbose]\n";
+    return 1;
   }
-  if (no_winner > 0) {
-    std::cout << "No winner: " << no_winner << "\n";
+
+  tigerdragon::WorkStealingPool pool(options.threads);
+  // Per-game results are only kept for --verbose.
+  std::vector<GameResult> results(options.verbose ? options.games : 0);
+  std::vector<SimStats> thread_stats(pool.threads());
+
+  std::unique_ptr<tigerdragon::TrajectoryWriter> writer;
+  if (!options.record_dir.empty()) {
+    std::error_code error;
+    std::filesystem::create_directories(options.record_dir, error);
+    writer = std::make_unique<tigerdragon::TrajectoryWriter>(options.record_dir, "selfplay",
+                                                             options.shard_mb << 20);
   }
 
+  // When recording, games are played in blocks and each block is written in
+  // game order once it finishes, so shard contents do not depend on
+  // --threads and workers never wait on disk.
+  const int64_t block =
+      writer != nullptr ? std::max<int64_t>(1024, 64 * pool.threads()) : std::max<int64_t>(options.games, 1);
+  std::vector<std::vector<tigerdragon::TrajectoryRecord>> records;
+  const auto start = std::chrono::steady_clock::now();
+  for (int64_t first = 0; first < options.games; first += block) {
+    const int64_t count = std::min(block, options.games - first);
+    if (writer != nullptr) {
+      records.resize(count);
+    }
+    pool.ParallelFor(count, [&](int64_t offset, int worker) {
+      const int64_t game = first + offset;
+      const GameResult result = PlayGame(options, game, writer != nullptr ? &records[offset] : nullptr);
+      thread_stats[worker].Add(result);
+      if (options.verbose) {
+        results[game] = result;
+      }
+    });
+    if (writer != nullptr) {
+      for (int64_t offset = 0; offset < count; ++offset) {
+        writer->AddGame(records[offset].data(), records[offset].size());
+        records[offset].clear();
+      }
+    }
+  }
+  if (writer != nullptr && !writer->Close()) {
+    std::cerr << "Failed to write trajectories to " << options.record_dir << "\n";
+    return 1;
+  }
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  SimStats stats;
+  for (const auto& partial : thread_stats) {
+    stats.Merge(partial);
+  }
+
+  if (options.verbose) {
+    for (int64_t game = 0; game < options.games; ++game) {
+      std::cout << "Match " << game + 1 << ": Turns=" << results[game].turns << " ";
+      if (results[game].failed) {
+        std::cout << "Failed\n";
+      } else if (results[game].winner >= 0) {
+        std::cout << "Winner=Player " << results[game].winner << "\n";
+      } else {
+        std::cout << "No winner\n";
+      }
+    }
+  }
+
+  std::cout << "Summary: matches=" << stats.games << " avg_turns="
+            << (stats.games > 0 ? (stats.turns / stats.games) : 0) << "\n";
+  for (int player = 0; player < options.players; ++player) {
+    std::cout << "Player " << player << " wins: " << stats.wins[player] << "\n";
+  }
+  if (stats.no_winner > 0) {
+    std::cout << "No winner: " << stats.no_winner << "\n";
+  }
+  if (stats.failed > 0) {
+    std::cout << "Failed: " << stats.failed << "\n";
+  }
+  std::cerr << "threads=" << pool.threads() << " seconds=" << seconds
+            << " games/sec=" << (seconds > 0 ? stats.games / seconds : 0.0) << "\n";
+  if (stats.failed > 0) {
+    std::cerr << "error: " << stats.failed << " games failed (invalid or missing action)\n";
+    return 1;
+  }
   return 0;
 }
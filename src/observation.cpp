@@ -0,0 +1,70 @@
+#include "observation.h"
+
+#include <algorithm>
+
+namespace tigerdragon {
+
+namespace {
+
+template <typename T>
+void Encode(const ObservationView& view, T* out) {
+  using Layout = ObservationLayout;
+  std::fill(out, out + kObservationFeatures, T{0});
+
+  const Hand& own = view.own_hand();
+  const Hand& revealed = view.revealed();
+  for (int kind = 0; kind < kTileKinds; ++kind) {
+    out[Layout::kOwnHand + kind] = static_cast<T>(own.Count(static_cast<TileKind>(kind)));
+    out[Layout::kRevealed + kind] = static_cast<T>(revealed.Count(static_cast<TileKind>(kind)));
+  }
+
+  const int players = view.players();
+  // Relative index of an absolute seat.
+  auto relative = [&](int player) { return (player - view.seat() + players) % players; };
+  for (int offset = 0; offset < players; ++offset) {
+    const int player = view.SeatAt(offset);
+    out[Layout::kHandSizes + offset] = static_cast<T>(view.hand_size(player));
+    out[Layout::kBonusDiscards + offset] = static_cast<T>(view.bonus_discards(player));
+  }
+
+  if (view.attack_tile().has_value()) {
+    out[Layout::kAttackTile + static_cast<int>(view.attack_tile()->kind)] = T{1};
+  }
+  out[Layout::kPhase + static_cast<int>(view.phase())] = T{1};
+  out[Layout::kCurrentPlayer + relative(view.current_player())] = T{1};
+  if (view.attack_player() >= 0) {
+    out[Layout::kAttackPlayer + relative(view.attack_player())] = T{1};
+  }
+
+  for (uint16_t legal = view.legal_mask(); legal != 0; legal &= legal - 1) {
+    out[Layout::kLegalMoves + __builtin_ctz(legal)] = T{1};
+  }
+}
+
+template <typename T>
+void EncodeBatch(const GameState* states, const int* seats, int count, T* out) {
+  for (int i = 0; i < count; ++i) {
+    const int seat = seats != nullptr ? seats[i] : states[i].current_player;
+    Encode(ObservationView(states[i], seat), out + static_cast<size_t>(i) * kObservationFeatures);
+  }
+}
+
+}  // namespace
+
+void EncodeObservation(const ObservationView& view, float* out) {
+  Encode(view, out);
+}
+
+void EncodeObservation(const ObservationView& view, uint8_t* out) {
+  Encode(view, out);
+}
+
+void EncodeObservations(const GameState* states, const int* seats, int count, float* out) {
+  EncodeBatch(states, seats, count, out);
+}
+
+void EncodeObservations(const GameState* states, const int* seats, int count, uint8_t* out) {
+  EncodeBatch(states, seats, count, out);
+}
+
+}  // namespace tigerdragon
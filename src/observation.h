@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include "engine.h"
+
+namespace tigerdragon {
+
+// What `seat` may see of a GameState, without copying it: its own hand and
+// the public fields. Opponent hands are only exposed as sizes. The state
+// must outlive the view.
+class ObservationView {
+ public:
+  ObservationView(const GameState& state, int seat) : state_(&state), seat_(seat) {}
+
+  int seat() const { return seat_; }
+  int players() const { return state_->players; }
+  GameState::Phase phase() const { return state_->phase; }
+  int current_player() const { return state_->current_player; }
+  int attack_player() const { return state_->attack_player; }
+  const std::optional<Tile>& attack_tile() const { return state_->attack_tile; }
+  const Hand& own_hand() const { return state_->hands[seat_]; }
+  const Hand& revealed() const { return state_->revealed; }
+  int hand_size(int player) const { return state_->hands[player].Size(); }
+  int bonus_discards(int player) const { return state_->bonus_discards[player]; }
+  bool to_move() const { return !state_->finished && state_->current_player == seat_; }
+
+  // Legal move codes (LegalCodeMask) when this seat is to move, else 0.
+  uint16_t legal_mask() const { return to_move() ? LegalCodeMask(*state_) : 0; }
+
+  // The Action for a legal move code; only meaningful when to_move().
+  Action ActionForCode(uint8_t code) const { return ActionFromCode(*state_, code); }
+
+  // Absolute seat `offset` places after this one.
+  int SeatAt(int offset) const { return (seat_ + offset) % state_->players; }
+
+ private:
+  const GameState* state_;
+  int seat_;
+};
+
+// Fixed feature layout. Per-seat sections are ordered relative to the
+// observer (index 0 is the observer, 1 the next seat, ...) and zero for
+// seats beyond `players`. Counts are written as raw numbers, flags as 0/1.
+struct ObservationLayout {
+  static constexpr int kOwnHand = 0;                                  // Count per kind.
+  static constexpr int kHandSizes = kOwnHand + kTileKinds;            // Per relative seat.
+  static constexpr int kRevealed = kHandSizes + kMaxPlayers;          // Face-up tiles per kind.
+  static constexpr int kAttackTile = kRevealed + kTileKinds;          // One-hot kind.
+  static constexpr int kPhase = kAttackTile + kTileKinds;             // One-hot phase.
+  static constexpr int kCurrentPlayer = kPhase + 4;                   // One-hot relative seat.
+  static constexpr int kAttackPlayer = kCurrentPlayer + kMaxPlayers;  // One-hot relative seat.
+  static constexpr int kBonusDiscards = kAttackPlayer + kMaxPlayers;  // Per relative seat.
+  static constexpr int kLegalMoves = kBonusDiscards + kMaxPlayers;    // One flag per move code.
+  static constexpr int kSize = kLegalMoves + kMaxLegalActions;
+};
+
+constexpr int kObservationFeatures = ObservationLayout::kSize;
+
+// Write kObservationFeatures values to out.
+void EncodeObservation(const ObservationView& view, float* out);
+void EncodeObservation(const ObservationView& view, uint8_t* out);
+
+// Encodes states[i] as seen by seats[i] (the player to move when `seats`
+// is null) into out + i * kObservationFeatures.
+void EncodeObservations(const GameState* states, const int* seats, int count, float* out);
+void EncodeObservations(const GameState* states, const int* seats, int count, uint8_t* out);
+
+}  // namespace tigerdragon
@@ -0,0 +1,175 @@
+#include "engine.h"
+#include "work_stealing_pool.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using tigerdragon::Action;
+using tigerdragon::ActionList;
+using tigerdragon::GameConfig;
+using tigerdragon::GameState;
+
+namespace {
+
+struct PerftOptions {
+  int players = 2;
+  uint32_t seed = 42;
+  GameConfig::Rng rng = GameConfig::Rng::Mt19937;
+  uint64_t deal_index = 0;
+  int depth = 6;
+  // "index": one move per hand tile, as the vector GenerateLegalActions.
+  // "kind": one move per tile kind, as the ActionList overload.
+  std::string mode = "kind";
+  int threads = 1;
+  bool divide = false;
+};
+
+// Move sequences of length `depth` (finished rounds have no moves), using
+// the per-tile generator and state copies.
+uint64_t PerftIndex(const GameState& state, int depth) {
+  const std::vector<Action> actions = tigerdragon::GenerateLegalActions(state);
+  if (depth == 1) {
+    return actions.size();
+  }
+  uint64_t nodes = 0;
+  for (const Action& action : actions) {
+    GameState next = state;
+    tigerdragon::ApplyAction(next, action);
+    nodes += PerftIndex(next, depth - 1);
+  }
+  return nodes;
+}
+
+// As above with the per-kind generator and make/unmake.
+uint64_t PerftKind(GameState& state, int depth) {
+  ActionList actions;
+  tigerdragon::GenerateLegalActions(state, &actions);
+  if (depth == 1) {
+    return static_cast<uint64_t>(actions.size);
+  }
+  uint64_t nodes = 0;
+  for (const Action& action : actions) {
+    tigerdragon::UndoRecord undo;
+    tigerdragon::ApplyAction(state, action, &undo);
+    nodes += PerftKind(state, depth - 1);
+    tigerdragon::UndoAction(state, undo);
+  }
+  return nodes;
+}
+
+std::string MoveLabel(const Action& action, bool with_index) {
+  std::string label;
+  switch (action.type) {
+    case Action::Type::Attack:
+      label = "A:";
+      break;
+    case Action::Type::Defend:
+      label = "D:";
+      break;
+    case Action::Type::BonusReceive:
+      label = "B:";
+      break;
+    case Action::Type::Pass:
+      return "pass";
+  }
+  label += tigerdragon::ToString(action.tile);
+  if (with_index) {
+    label += "#" + std::to_string(action.hand_index);
+  }
+  return label;
+}
+
+bool ParseOptions(int argc, char** argv, PerftOptions* options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--divide") {
+      options->divide = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const char* value = argv[++i];
+    if (arg == "--players") {
+      options->players = std::atoi(value);
+    } else if (arg == "--seed") {
+      options->seed = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    } else if (arg == "--rng") {
+      const std::string rng = value;
+      if (rng != "mt19937" && rng != "philox") {
+        return false;
+      }
+      options->rng = rng == "philox" ? GameConfig::Rng::Philox : GameConfig::Rng::Mt19937;
+    } else if (arg == "--deal-index") {
+      options->deal_index = std::strtoull(value, nullptr, 10);
+    } else if (arg == "--depth") {
+      options->depth = std::atoi(value);
+    } else if (arg == "--mode") {
+      options->mode = value;
+    } else if (arg == "--threads") {
+      options->threads = std::atoi(value);
+    } else {
+      return false;
+    }
+  }
+  return options->players >= 2 && options->players <= tigerdragon::kMaxPlayers && options->depth >= 1 &&
+         (options->mode == "index" || options->mode == "kind");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  PerftOptions options;
+  if (!ParseOptions(argc, argv, &options)) {
+    std::cerr << "Usage: perft [--players 2-5] [--seed N] [--rng mt19937|philox] [--deal-index N]"
+                 " [--depth N] [--mode index|kind] [--threads N] [--divide]\n";
+    return 1;
+  }
+
+  GameConfig config;
+  config.players = options.players;
+  config.seed = options.seed;
+  config.rng = options.rng;
+  config.deal_index = options.deal_index;
+  const GameState root = tigerdragon::CreateInitialState(config);
+
+  const bool by_index = options.mode == "index";
+  std::vector<Action> moves;
+  if (by_index) {
+    moves = tigerdragon::GenerateLegalActions(root);
+  } else {
+    ActionList actions;
+    tigerdragon::GenerateLegalActions(root, &actions);
+    moves.assign(actions.begin(), actions.end());
+  }
+
+  // Root moves are split across the pool; each subtree is counted on one
+  // thread.
+  tigerdragon::WorkStealingPool pool(options.threads);
+  std::vector<uint64_t> counts(moves.size(), 1);
+  const auto start = std::chrono::steady_clock::now();
+  if (options.depth > 1) {
+    pool.ParallelFor(static_cast<int64_t>(moves.size()), [&](int64_t i, int) {
+      GameState state = root;
+      tigerdragon::ApplyAction(state, moves[i]);
+      counts[i] = by_index ? PerftIndex(state, options.depth - 1) : PerftKind(state, options.depth - 1);
+    });
+  }
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  uint64_t nodes = 0;
+  for (size_t i = 0; i < moves.size(); ++i) {
+    if (options.divide) {
+      std::cout << MoveLabel(moves[i], by_index) << ": " << counts[i] << "\n";
+    }
+    nodes += counts[i];
+  }
+  std::cout << "Nodes: " << nodes << "\n";
+  std::cerr << "mode=" << options.mode << " depth=" << options.depth << " threads=" << pool.threads()
+            << " seconds=" << seconds << " nodes/sec=" << (seconds > 0 ? nodes / seconds : 0.0) << "\n";
+  return 0;
+}
@@ -13,4 +13,13 @@ bool RandomPlayer::ChooseAction(const std::vector<Action>& actions, Action* out_
   return true;
 }
 
+bool RandomPlayer::ChooseAction(const ActionList& actions, Action* out_action) {
+  if (actions.empty() || out_action == nullptr) {
+    return false;
+  }
+  std::uniform_int_distribution<int> dist(0, actions.size - 1);
+  *out_action = actions[dist(rng_)];
+  return true;
+}
+
 }  // namespace tigerdragon
@@ -12,6 +12,7 @@ class RandomPlayer {
   explicit RandomPlayer(uint32_t seed);
 
   bool ChooseAction(const std::vector<Action>& actions, Action* out_action);
+  bool ChooseAction(const ActionList& actions, Action* out_action);
 
  private:
   std::mt19937 rng_;
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+namespace tigerdragon {
+
+// SplitMix64 finalizer: a cheap, well-mixed 64-bit hash.
+constexpr uint64_t Mix64(uint64_t z) {
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+inline uint64_t SplitMix64(uint64_t& state) {
+  state += 0x9E3779B97F4A7C15ULL;
+  return Mix64(state);
+}
+
+// Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as
+// 1, 2, 3"). Output block i of stream `key` is a pure function of
+// (key, counter), so any position can be generated directly.
+class Philox4x32 {
+ public:
+  using Block = std::array<uint32_t, 4>;
+
+  static Block Generate(uint64_t key, Block counter) {
+    uint32_t k0 = static_cast<uint32_t>(key);
+    uint32_t k1 = static_cast<uint32_t>(key >> 32);
+    for (int round = 0; round < 10; ++round) {
+      const uint64_t p0 = static_cast<uint64_t>(0xD2511F53u) * counter[0];
+      const uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57u) * counter[2];
+      counter = {static_cast<uint32_t>(p1 >> 32) ^ counter[1] ^ k0, static_cast<uint32_t>(p1),
+                 static_cast<uint32_t>(p0 >> 32) ^ counter[3] ^ k1, static_cast<uint32_t>(p0)};
+      k0 += 0x9E3779B9u;
+      k1 += 0xBB67AE85u;
+    }
+    return counter;
+  }
+};
+
+// UniformRandomBitGenerator over one Philox stream: (key, stream) select
+// the sequence and Seek jumps to any output position in O(1).
+class PhiloxEngine {
+ public:
+  using result_type = uint32_t;
+
+  PhiloxEngine(uint64_t key, uint64_t stream) : key_(key), stream_(stream) {}
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+  result_type operator()() {
+    if ((position_ & 3) == 0) {
+      block_ = Philox4x32::Generate(
+          key_, {static_cast<uint32_t>(position_ >> 2), static_cast<uint32_t>(position_ >> 34),
+                 static_cast<uint32_t>(stream_), static_cast<uint32_t>(stream_ >> 32)});
+    }
+    return block_[position_++ & 3];
+  }
+
+  void Seek(uint64_t position) {
+    position_ = position & ~uint64_t{3};
+    const uint64_t skip = position & 3;
+    for (uint64_t i = 0; i < skip; ++i) {
+      (*this)();
+    }
+  }
+
+  // Uniform integer in [0, bound) by multiply-shift (Lemire); the bias is
+  // below bound / 2^32, negligible for the small bounds used here.
+  uint32_t Below(uint32_t bound) {
+    return static_cast<uint32_t>((static_cast<uint64_t>((*this)()) * bound) >> 32);
+  }
+
+ private:
+  uint64_t key_ = 0;
+  uint64_t stream_ = 0;
+  uint64_t position_ = 0;
+  Philox4x32::Block block_{};
+};
+
+}  // namespace tigerdragon
@@ -123,7 +123,7 @@ void RenderState(const GameState& state,
     std::cout << "\n";
   }
   for (int player = 0; player < state.players; ++player) {
-    std::cout << "Player " << player << " hand size: " << state.hands[player].size() << "\n";
+    std::cout << "Player " << player << " hand size: " << state.hands[player].Size() << "\n";
   }
   std::cout << "==============\n";
 }
@@ -141,7 +141,7 @@ std::string ReadToken() {
   }
 }
 
-void PrintAction(const GameState& state, const Action& action, int index) {
+void PrintAction(const Action& action, int index) {
   if (index >= 0) {
     std::cout << "  (" << index << ") ";
   } else {
@@ -163,32 +163,22 @@ void PrintAction(const GameState& state, const Action& action, int index) {
       std::cout << color << "Bonus" << reset << " receive with hand[" << action.hand_index << "]";
       break;
   }
-  if (action.hand_index >= 0) {
-    const auto& hand = state.hands[action.player];
-    if (action.hand_index < static_cast<int>(hand.size())) {
-      std::cout << " -> " << tigerdragon::ToString(hand[action.hand_index].kind);
-    }
+  if (action.type != Action::Type::Pass) {
+    std::cout << " -> " << tigerdragon::ToString(action.tile);
   }
   std::cout << "\n";
 }
 
-std::optional<Action> FindActionByTile(const GameState& state,
-                                       const std::vector<Action>& actions,
-                                       Action::Type type,
-                                       TileKind kind) {
+std::optional<Action> FindActionByTile(const tigerdragon::ActionList& actions, TileKind kind) {
   for (const auto& action : actions) {
-    if (action.type != type || action.hand_index < 0 ||
-        action.hand_index >= static_cast<int>(state.hands[action.player].size())) {
-      continue;
-    }
-    if (state.hands[action.player][action.hand_index].kind == kind) {
+    if (action.type != Action::Type::Pass && action.tile == kind) {
       return action;
     }
   }
   return std::nullopt;
 }
 
-std::optional<Action> FindPass(const std::vector<Action>& actions) {
+std::optional<Action> FindPass(const tigerdragon::ActionList& actions) {
   for (const auto& action : actions) {
     if (action.type == Action::Type::Pass) {
       return action;
@@ -256,14 +246,15 @@ int main(int argc, char** argv) {
 
   while (!state.finished) {
     RenderState(state, last_action, last_tile);
-    auto actions = tigerdragon::GenerateLegalActions(state);
+    tigerdragon::ActionList actions;
+    tigerdragon::GenerateLegalActions(state, &actions);
     if (actions.empty()) {
       std::cout << "No legal actions.\n";
       break;
     }
     Action action;
     if (state.current_player == human_player) {
-      PrintHandInline(state.hands[state.current_player]);
+      PrintHandInline(tigerdragon::HandTiles(state.hands[state.current_player]));
       while (true) {
         std::string token = ReadToken();
         std::string lower;
@@ -289,13 +280,7 @@ int main(int argc, char** argv) {
           std::cout << "Invalid input.\n";
           continue;
         }
-        Action::Type desired_type = Action::Type::Attack;
-        if (state.phase == GameState::Phase::Defend) {
-          desired_type = Action::Type::Defend;
-        } else if (state.phase == GameState::Phase::BonusReceive) {
-          desired_type = Action::Type::BonusReceive;
-        }
-        auto chosen = FindActionByTile(state, actions, desired_type, tile_kind.value());
+        auto chosen = FindActionByTile(actions, tile_kind.value());
         if (chosen.has_value()) {
           action = chosen.value();
           break;
@@ -308,12 +293,12 @@ int main(int argc, char** argv) {
         break;
       }
       std::cout << "Random player " << state.current_player << " selects:\n";
-      PrintAction(state, action, -1);
+      PrintAction(action, -1);
     }
 
     last_tile.reset();
-    if (action.hand_index >= 0 && action.hand_index < static_cast<int>(state.hands[action.player].size())) {
-      last_tile = state.hands[action.player][action.hand_index].kind;
+    if (action.type != Action::Type::Pass) {
+      last_tile = action.tile;
     }
 
     if (!tigerdragon::ApplyAction(state, action)) {
@@ -321,12 +306,6 @@ int main(int argc, char** argv) {
       continue;
     }
     last_action = action;
-
-    if (state.hands[action.player].empty()) {
-      state.finished = true;
-      state.winner = action.player;
-      state.phase = GameState::Phase::Finished;
-    }
   }
 
   if (state.winner >= 0) {
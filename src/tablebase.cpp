@@ -0,0 +1,354 @@
+#include "tablebase.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "work_stealing_pool.h"
+
+namespace tigerdragon {
+
+namespace {
+
+constexpr char kMagic[8] = {'T', 'D', 'T', 'B', '2', 'P', '\0', '\0'};
+constexpr uint32_t kVersion = 1;
+
+// Phase slots: attack, bonus discard, or defending against each kind.
+constexpr int kSlotAttack = 0;
+constexpr int kSlotBonus = 1;
+constexpr int kSlotDefend = 2;
+constexpr int kSlots = kSlotDefend + kTileKinds;
+
+constexpr int kValueWin = static_cast<int>(Tablebase::Value::Win);
+constexpr int kValueLoss = static_cast<int>(Tablebase::Value::Loss);
+
+// Ranks per parallel work item; a multiple of 32 so no two items share a
+// word of any slot.
+constexpr uint64_t kChunkWords = 64;
+constexpr uint64_t kChunkRanks = kChunkWords * 32;
+
+// Data starts on its own page after the header. Each layer holds kSlots
+// arrays of 2-bit values, 32 per word.
+constexpr size_t kHeaderBytes = 4096;
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t max_tiles;
+  int32_t complete_tiles;  // Highest finished layer, -1 before the first.
+  uint32_t reserved;
+  uint64_t layer_offsets[kMaxTablebaseTiles + 1];  // In words from the data start.
+  uint64_t total_words;
+};
+
+static_assert(sizeof(FileHeader) <= kHeaderBytes, "header must fit before the data page");
+
+uint64_t SlotWords(uint64_t layer_size) {
+  return (layer_size + 31) / 32;
+}
+
+FileHeader MakeHeader(const TablebaseIndex& index) {
+  FileHeader header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.max_tiles = static_cast<uint32_t>(index.max_tiles());
+  header.complete_tiles = -1;
+  uint64_t total = 0;
+  for (int tiles = 0; tiles <= index.max_tiles(); ++tiles) {
+    header.layer_offsets[tiles] = total;
+    total += kSlots * SlotWords(index.LayerSize(tiles));
+  }
+  header.total_words = total;
+  return header;
+}
+
+bool SameLayout(const FileHeader& a, const FileHeader& b) {
+  return std::memcmp(a.magic, b.magic, sizeof(a.magic)) == 0 && a.version == b.version &&
+         a.max_tiles == b.max_tiles && a.total_words == b.total_words;
+}
+
+int ReadValue(const uint64_t* words, uint64_t layer_offset, uint64_t layer_size, int slot, uint64_t rank) {
+  const uint64_t word = words[layer_offset + slot * SlotWords(layer_size) + rank / 32];
+  return static_cast<int>((word >> ((rank % 32) * 2)) & 3);
+}
+
+class LayerBuilder {
+ public:
+  LayerBuilder(const TablebaseIndex& index, const FileHeader& header, uint64_t* words)
+      : index_(index), header_(header), words_(words) {}
+
+  void Build(int tiles, WorkStealingPool& pool) {
+    const uint64_t chunks = (index_.LayerSize(tiles) + kChunkRanks - 1) / kChunkRanks;
+    // Attack and bonus positions only lead to the layer below; defending
+    // positions may pass into a bonus position of this layer.
+    pool.ParallelFor(static_cast<int64_t>(chunks), [&](int64_t chunk, int) {
+      BuildChunk(tiles, static_cast<uint64_t>(chunk), kSlotAttack, kSlotDefend);
+    });
+    pool.ParallelFor(static_cast<int64_t>(chunks), [&](int64_t chunk, int) {
+      BuildChunk(tiles, static_cast<uint64_t>(chunk), kSlotDefend, kSlots);
+    });
+  }
+
+ private:
+  int Get(int tiles, int slot, const Hand& mover, const Hand& other) const {
+    return ReadValue(words_, header_.layer_offsets[tiles], index_.LayerSize(tiles), slot,
+                     index_.Rank(mover, other));
+  }
+
+  // Same rules as ApplyAction with two players: an attack hands the move
+  // to the defender, a defence or bonus discard keeps it, and a pass gives
+  // the attacker a bonus discard.
+  int Evaluate(int tiles, int slot, const Hand& mover, const Hand& other) const {
+    uint16_t playable = mover.KindMask();
+    if (slot >= kSlotDefend) {
+      const TileKind attack = static_cast<TileKind>(slot - kSlotDefend);
+      if (Get(tiles, kSlotBonus, other, mover) == kValueLoss) {
+        return kValueWin;
+      }
+      playable &= DefendMask(attack);
+    }
+    for (; playable != 0; playable &= playable - 1) {
+      const TileKind kind = static_cast<TileKind>(__builtin_ctz(playable));
+      Hand rest = mover;
+      rest.Remove(kind);
+      if (rest.Empty()) {
+        return kValueWin;
+      }
+      const bool win = slot == kSlotAttack
+                           ? Get(tiles - 1, kSlotDefend + static_cast<int>(kind), other, rest) == kValueLoss
+                           : Get(tiles - 1, kSlotAttack, rest, other) == kValueWin;
+      if (win) {
+        return kValueWin;
+      }
+    }
+    return kValueLoss;
+  }
+
+  void BuildChunk(int tiles, uint64_t chunk, int first_slot, int end_slot) {
+    const uint64_t size = index_.LayerSize(tiles);
+    const uint64_t begin = chunk * kChunkRanks;
+    const uint64_t end = std::min(size, begin + kChunkRanks);
+    uint64_t local[kSlots][kChunkWords] = {};
+    for (uint64_t rank = begin; rank < end; ++rank) {
+      Hand mover;
+      Hand other;
+      index_.Unrank(tiles, rank, &mover, &other);
+      if (mover.Empty() || other.Empty()) {
+        continue;
+      }
+      for (int slot = first_slot; slot < end_slot; ++slot) {
+        const uint64_t value = static_cast<uint64_t>(Evaluate(tiles, slot, mover, other));
+        local[slot][(rank - begin) / 32] |= value << (((rank - begin) % 32) * 2);
+      }
+    }
+    const uint64_t slot_words = SlotWords(size);
+    const uint64_t word_count = (end - begin + 31) / 32;
+    for (int slot = first_slot; slot < end_slot; ++slot) {
+      uint64_t* out = words_ + header_.layer_offsets[tiles] + slot * slot_words + begin / 32;
+      std::memcpy(out, local[slot], word_count * sizeof(uint64_t));
+    }
+  }
+
+  const TablebaseIndex& index_;
+  const FileHeader& header_;
+  uint64_t* words_;
+};
+
+}  // namespace
+
+TablebaseIndex::TablebaseIndex(int max_tiles) : max_tiles_(max_tiles) {
+  for (int kind = 0; kind < kTileKinds; ++kind) {
+    const int deck = DeckCount(static_cast<TileKind>(kind));
+    for (int sum = 0; sum <= deck; ++sum) {
+      for (int mover = 0; mover <= sum; ++mover) {
+        option_index_[kind][mover * 9 + (sum - mover)] = static_cast<uint8_t>(options_[kind].size());
+        options_[kind].push_back({static_cast<uint8_t>(mover), static_cast<uint8_t>(sum - mover)});
+      }
+    }
+  }
+
+  ways_[kTileKinds].assign(max_tiles + 1, 0);
+  ways_[kTileKinds][0] = 1;
+  for (int kind = kTileKinds - 1; kind >= 0; --kind) {
+    ways_[kind].assign(max_tiles + 1, 0);
+    offsets_[kind].assign(static_cast<size_t>(max_tiles + 1) * kMaxOptions, 0);
+    for (int remaining = 0; remaining <= max_tiles; ++remaining) {
+      uint64_t skipped = 0;
+      for (size_t option = 0; option < options_[kind].size(); ++option) {
+        offsets_[kind][remaining * kMaxOptions + option] = skipped;
+        const int sum = options_[kind][option][0] + options_[kind][option][1];
+        if (sum <= remaining) {
+          skipped += ways_[kind + 1][remaining - sum];
+        }
+      }
+      ways_[kind][remaining] = skipped;
+    }
+  }
+}
+
+uint64_t TablebaseIndex::Rank(const Hand& mover, const Hand& other) const {
+  int remaining = mover.Size() + other.Size();
+  uint64_t rank = 0;
+  for (int kind = 0; kind < kTileKinds; ++kind) {
+    const int a = mover.Count(static_cast<TileKind>(kind));
+    const int b = other.Count(static_cast<TileKind>(kind));
+    rank += offsets_[kind][remaining * kMaxOptions + option_index_[kind][a * 9 + b]];
+    remaining -= a + b;
+  }
+  return rank;
+}
+
+void TablebaseIndex::Unrank(int tiles, uint64_t rank, Hand* mover, Hand* other) const {
+  *mover = Hand{};
+  *other = Hand{};
+  int remaining = tiles;
+  for (int kind = 0; kind < kTileKinds; ++kind) {
+    for (const auto& option : options_[kind]) {
+      const int sum = option[0] + option[1];
+      if (sum > remaining) {
+        break;
+      }
+      const uint64_t count = ways_[kind + 1][remaining - sum];
+      if (rank < count) {
+        mover->Add(static_cast<TileKind>(kind), option[0]);
+        other->Add(static_cast<TileKind>(kind), option[1]);
+        remaining -= sum;
+        break;
+      }
+      rank -= count;
+    }
+  }
+}
+
+Tablebase::~Tablebase() {
+  Close();
+}
+
+bool Tablebase::Open(const std::string& path) {
+  Close();
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < kHeaderBytes) {
+    close(fd);
+    return false;
+  }
+  void* map = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+  map_ = static_cast<const uint8_t*>(map);
+  map_size_ = static_cast<size_t>(info.st_size);
+
+  FileHeader header;
+  std::memcpy(&header, map_, sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+      header.max_tiles > static_cast<uint32_t>(kMaxTablebaseTiles)) {
+    Close();
+    return false;
+  }
+  index_ = std::make_unique<TablebaseIndex>(static_cast<int>(header.max_tiles));
+  if (!SameLayout(header, MakeHeader(*index_)) || map_size_ < kHeaderBytes + header.total_words * sizeof(uint64_t)) {
+    Close();
+    return false;
+  }
+  std::memcpy(layer_offsets_.data(), header.layer_offsets, sizeof(header.layer_offsets));
+  complete_tiles_ = header.complete_tiles;
+  data_ = reinterpret_cast<const uint64_t*>(map_ + kHeaderBytes);
+  madvise(map, map_size_, MADV_RANDOM);
+  return true;
+}
+
+void Tablebase::Close() {
+  if (map_ != nullptr) {
+    munmap(const_cast<uint8_t*>(map_), map_size_);
+  }
+  map_ = nullptr;
+  map_size_ = 0;
+  data_ = nullptr;
+  complete_tiles_ = -1;
+  index_.reset();
+}
+
+Tablebase::Value Tablebase::Probe(const GameState& state) const {
+  if (data_ == nullptr || state.players != 2 || state.finished) {
+    return Value::Unknown;
+  }
+  const Hand& mover = state.hands[state.current_player];
+  const Hand& other = state.hands[1 - state.current_player];
+  const int tiles = mover.Size() + other.Size();
+  if (tiles > complete_tiles_) {
+    return Value::Unknown;
+  }
+  int slot = kSlotAttack;
+  if (state.phase == GameState::Phase::BonusReceive) {
+    slot = kSlotBonus;
+  } else if (state.phase == GameState::Phase::Defend) {
+    if (!state.attack_tile.has_value()) {
+      return Value::Unknown;
+    }
+    slot = kSlotDefend + static_cast<int>(state.attack_tile->kind);
+  }
+  return static_cast<Value>(ReadValue(data_, layer_offsets_[tiles], index_->LayerSize(tiles), slot,
+                                      index_->Rank(mover, other)));
+}
+
+bool GenerateTablebase(const std::string& path, int max_tiles, WorkStealingPool& pool, std::ostream* log) {
+  if (max_tiles < 0 || max_tiles > kMaxTablebaseTiles) {
+    return false;
+  }
+  const TablebaseIndex index(max_tiles);
+  const FileHeader expected = MakeHeader(index);
+  const size_t file_size = kHeaderBytes + expected.total_words * sizeof(uint64_t);
+
+  const int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  FileHeader existing{};
+  const bool resume = fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) == file_size &&
+                      pread(fd, &existing, sizeof(existing), 0) == static_cast<ssize_t>(sizeof(existing)) &&
+                      SameLayout(existing, expected);
+  if (!resume) {
+    if (ftruncate(fd, 0) != 0 || ftruncate(fd, static_cast<off_t>(file_size)) != 0 ||
+        pwrite(fd, &expected, sizeof(expected), 0) != static_cast<ssize_t>(sizeof(expected))) {
+      close(fd);
+      return false;
+    }
+  }
+  void* map = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+
+  FileHeader* header = static_cast<FileHeader*>(map);
+  uint64_t* words = reinterpret_cast<uint64_t*>(static_cast<uint8_t*>(map) + kHeaderBytes);
+  LayerBuilder builder(index, *header, words);
+  bool ok = true;
+  for (int tiles = header->complete_tiles + 1; tiles <= max_tiles && ok; ++tiles) {
+    const auto start = std::chrono::steady_clock::now();
+    builder.Build(tiles, pool);
+    ok = msync(map, file_size, MS_SYNC) == 0;
+    header->complete_tiles = tiles;
+    ok = ok && msync(map, kHeaderBytes, MS_SYNC) == 0;
+    if (log != nullptr) {
+      *log << "tiles=" << tiles << " positions=" << index.LayerSize(tiles) << " seconds="
+           << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << "\n";
+    }
+  }
+  munmap(map, file_size);
+  return ok;
+}
+
+}  // namespace tigerdragon
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "engine.h"
+
+namespace tigerdragon {
+
+class WorkStealingPool;
+
+constexpr int kMaxTablebaseTiles = 24;
+
+// Perfect hash for 2-player positions by total tiles held. A position is
+// the (mover, other) pair of per-kind counts. Ranks within a layer are
+// dense, and Rank is a sum of one table lookup per kind.
+class TablebaseIndex {
+ public:
+  explicit TablebaseIndex(int max_tiles);
+
+  int max_tiles() const { return max_tiles_; }
+  uint64_t LayerSize(int tiles) const { return ways_[0][tiles]; }
+
+  uint64_t Rank(const Hand& mover, const Hand& other) const;
+  void Unrank(int tiles, uint64_t rank, Hand* mover, Hand* other) const;
+
+ private:
+  // (mover, other) counts of one kind, ordered by their sum.
+  static constexpr int kMaxOptions = 45;
+
+  int max_tiles_;
+  std::array<std::vector<std::array<uint8_t, 2>>, kTileKinds> options_;
+  // option_index_[k][mover * 9 + other]
+  std::array<std::array<uint8_t, 81>, kTileKinds> option_index_{};
+  // ways_[k][r]: count assignments of kinds k..9 holding r tiles in total.
+  std::array<std::vector<uint64_t>, kTileKinds + 1> ways_;
+  // offsets_[k][r * kMaxOptions + option]: ranks skipped by choosing
+  // `option` for kind k with r tiles left.
+  std::array<std::vector<uint64_t>, kTileKinds> offsets_;
+};
+
+// Exact 2-player outcomes for every position with at most max_tiles tiles
+// in both hands, one 2-bit value per (position, phase slot), loaded
+// read-only with mmap. Bonus discard counts never change who wins, so they
+// are not part of the key.
+class Tablebase {
+ public:
+  enum class Value : uint8_t {
+    Unknown,
+    Win,   // The player to move wins.
+    Loss,
+  };
+
+  Tablebase() = default;
+  ~Tablebase();
+
+  Tablebase(const Tablebase&) = delete;
+  Tablebase& operator=(const Tablebase&) = delete;
+
+  bool Open(const std::string& path);
+  void Close();
+  bool is_open() const { return data_ != nullptr; }
+  // Layers 0..complete_tiles() are available.
+  int complete_tiles() const { return complete_tiles_; }
+
+  // Unknown when the state is not a 2-player round in progress or holds
+  // more tiles than the file covers. Does not allocate.
+  Value Probe(const GameState& state) const;
+
+ private:
+  const uint8_t* map_ = nullptr;
+  size_t map_size_ = 0;
+  const uint64_t* data_ = nullptr;
+  std::array<uint64_t, kMaxTablebaseTiles + 1> layer_offsets_{};
+  int complete_tiles_ = -1;
+  std::unique_ptr<TablebaseIndex> index_;
+};
+
+// Builds (or resumes building) the file at `path` by backward induction
+// over layers of total tiles. Each finished layer is flushed and recorded
+// in the header, so an interrupted run continues from the next layer.
+// Progress goes to `log` when it is not null.
+bool GenerateTablebase(const std::string& path, int max_tiles, WorkStealingPool& pool, std::ostream* log);
+
+}  // namespace tigerdragon
@@ -0,0 +1,43 @@
+#include "tablebase.h"
+#include "work_stealing_pool.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv) {
+  std::string out = "tigerdragon_2p.tb";
+  int max_tiles = 12;
+  int threads = 0;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      out.clear();
+      break;
+    }
+    const char* value = argv[++i];
+    if (arg == "--out") {
+      out = value;
+    } else if (arg == "--max-tiles") {
+      max_tiles = std::atoi(value);
+    } else if (arg == "--threads") {
+      threads = std::atoi(value);
+    } else {
+      out.clear();
+      break;
+    }
+  }
+  if (out.empty() || max_tiles < 0 || max_tiles > tigerdragon::kMaxTablebaseTiles) {
+    std::cerr << "Usage: tablebase_gen [--out FILE] [--max-tiles 0-" << tigerdragon::kMaxTablebaseTiles
+              << "] [--threads N]\n";
+    return 1;
+  }
+
+  tigerdragon::WorkStealingPool pool(threads);
+  if (!tigerdragon::GenerateTablebase(out, max_tiles, pool, &std::cerr)) {
+    std::cerr << "Failed to write " << out << "\n";
+    return 1;
+  }
+  std::cout << "Wrote " << out << " (tiles <= " << max_tiles << ")\n";
+  return 0;
+}
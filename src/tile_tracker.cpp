@@ -0,0 +1,148 @@
+#include "tile_tracker.h"
+
+#include <algorithm>
+
+namespace tigerdragon {
+
+TileTracker::TileTracker(const GameState& state, int seat, const TileTrackerConfig& config)
+    : config_(config), seat_(seat), players_(state.players), own_hand_(state.hands[seat]) {
+  int total_unseen = 0;
+  for (int kind = 0; kind < kTileKinds; ++kind) {
+    const TileKind tile = static_cast<TileKind>(kind);
+    unseen_[kind] = DeckCount(tile) - own_hand_.Count(tile) - state.revealed.Count(tile);
+    total_unseen += unseen_[kind];
+  }
+  pile_ = total_unseen;
+  for (int player = 0; player < players_; ++player) {
+    sizes_[player] = state.hands[player].Size();
+    weights_[player].fill(1.0);
+    if (player != seat_) {
+      pile_ -= sizes_[player];
+    }
+  }
+}
+
+void TileTracker::Apply(const GameState& before, const Action& action) {
+  const int player = action.player;
+  const int kind = static_cast<int>(action.tile);
+  switch (action.type) {
+    case Action::Type::Attack:
+    case Action::Type::Defend:
+      --sizes_[player];
+      if (player == seat_) {
+        own_hand_.Remove(action.tile);
+        return;
+      }
+      --unseen_[kind];
+      // Proof that the pass evidence was wrong for this kind.
+      excluded_[player] &= static_cast<uint16_t>(~(1u << kind));
+      weights_[player][kind] = 1.0;
+      return;
+    case Action::Type::BonusReceive:
+      --sizes_[player];
+      if (player == seat_) {
+        own_hand_.Remove(action.tile);
+      } else {
+        ++pile_;
+      }
+      return;
+    case Action::Type::Pass:
+      if (player == seat_ || !before.attack_tile.has_value()) {
+        return;
+      }
+      const uint16_t mask = DefendMask(before.attack_tile->kind);
+      if (config_.pass_likelihood <= 0.0) {
+        excluded_[player] |= mask;
+      }
+      for (int defend = 0; defend < kTileKinds; ++defend) {
+        if (mask >> defend & 1) {
+          weights_[player][defend] *= std::max(config_.pass_likelihood, 0.0);
+        }
+      }
+      return;
+  }
+}
+
+uint16_t TileTracker::excluded(int player) const {
+  if (player == seat_) {
+    return 0;
+  }
+  uint16_t mask = excluded_[player];
+  for (int kind = 0; kind < kTileKinds; ++kind) {
+    if (unseen_[kind] == 0) {
+      mask |= static_cast<uint16_t>(1u << kind);
+    }
+  }
+  return mask;
+}
+
+double TileTracker::Share(int player, int kind) const {
+  double total = pile_;
+  for (int other = 0; other < players_; ++other) {
+    if (other != seat_) {
+      total += sizes_[other] * weights_[other][kind];
+    }
+  }
+  return total > 0.0 ? sizes_[player] * weights_[player][kind] / total : 0.0;
+}
+
+double TileTracker::ExpectedCount(int player, TileKind kind) const {
+  if (player == seat_) {
+    return own_hand_.Count(kind);
+  }
+  const int index = static_cast<int>(kind);
+  return unseen_[index] * Share(player, index);
+}
+
+double TileTracker::HoldProbability(int player, TileKind kind) const {
+  if (player == seat_) {
+    return own_hand_.Count(kind) > 0 ? 1.0 : 0.0;
+  }
+  // Drawing the kind's unseen tiles without replacement from all unknown
+  // slots, with the player owning an effective Share of them; exact when
+  // the weights are 1.
+  const int index = static_cast<int>(kind);
+  int slots = pile_;
+  for (int other = 0; other < players_; ++other) {
+    if (other != seat_) {
+      slots += sizes_[other];
+    }
+  }
+  const double owned = Share(player, index) * slots;
+  double none = 1.0;
+  for (int i = 0; i < unseen_[index] && none > 0.0; ++i) {
+    none *= std::max(0.0, (slots - owned - i) / (slots - i));
+  }
+  return 1.0 - none;
+}
+
+void TileTracker::Marginals(float* expected, float* hold) const {
+  for (int player = 0; player < kMaxPlayers; ++player) {
+    for (int kind = 0; kind < kTileKinds; ++kind) {
+      const int at = player * kTileKinds + kind;
+      const bool active = player < players_;
+      if (expected != nullptr) {
+        expected[at] = active ? static_cast<float>(ExpectedCount(player, static_cast<TileKind>(kind))) : 0.0f;
+      }
+      if (hold != nullptr) {
+        hold[at] = active ? static_cast<float>(HoldProbability(player, static_cast<TileKind>(kind))) : 0.0f;
+      }
+    }
+  }
+}
+
+void TileTracker::FillExclusions(Observation* observation) const {
+  for (int player = 0; player < players_; ++player) {
+    observation->excluded[player] = player == seat_ ? 0 : excluded_[player];
+  }
+}
+
+void TrackerMarginals(const TileTracker* const* trackers, int count, float* expected, float* hold) {
+  constexpr int kStride = kMaxPlayers * kTileKinds;
+  for (int i = 0; i < count; ++i) {
+    trackers[i]->Marginals(expected != nullptr ? expected + i * kStride : nullptr,
+                           hold != nullptr ? hold + i * kStride : nullptr);
+  }
+}
+
+}  // namespace tigerdragon
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "determinization.h"
+#include "engine.h"
+
+namespace tigerdragon {
+
+struct TileTrackerConfig {
+  // Chance that a player able to defend passes anyway. Each pass scales the
+  // tracked player's weight for every defending kind by this factor; 0
+  // treats passes as forced and turns them into hard exclusions.
+  double pass_likelihood = 0.35;
+};
+
+// Beliefs of one seat about where the unseen tiles are, kept up to date
+// one action at a time. Every unseen tile is in an opponent's hand or in
+// the hidden pile (undealt tiles and other seats' face-down bonus
+// discards); a tile of kind k sits with opponent p in proportion to
+// hand_size(p) * weight(p, k), and in the pile in proportion to its size.
+// With no pass evidence (all weights 1) the marginals are exact.
+class TileTracker {
+ public:
+  // Starts from `state` as seen by `seat`. Passes made before this point
+  // are unknown and carry no evidence.
+  TileTracker(const GameState& state, int seat, const TileTrackerConfig& config = {});
+
+  // `before` is the state `action` is applied to. O(1).
+  void Apply(const GameState& before, const Action& action);
+
+  int seat() const { return seat_; }
+  int players() const { return players_; }
+  int unseen(TileKind kind) const { return unseen_[static_cast<int>(kind)]; }
+  int hand_size(int player) const { return sizes_[player]; }
+  int hidden_pile() const { return pile_; }
+  double weight(int player, TileKind kind) const { return weights_[player][static_cast<int>(kind)]; }
+
+  // Kinds `player` is known not to hold (forced-pass exclusions, plus kinds
+  // with no unseen tiles). Always 0 for the tracking seat.
+  uint16_t excluded(int player) const;
+
+  double ExpectedCount(int player, TileKind kind) const;
+  double HoldProbability(int player, TileKind kind) const;
+
+  // Both tables for every seat at once: out[player * kTileKinds + kind],
+  // kMaxPlayers rows, zero past players(). The tracking seat's own row is
+  // exact. Either pointer may be null.
+  void Marginals(float* expected, float* hold) const;
+
+  // Copies the hard exclusions into observation->excluded for
+  // DeterminizationSampler.
+  void FillExclusions(Observation* observation) const;
+
+ private:
+  double Share(int player, int kind) const;
+
+  TileTrackerConfig config_;
+  int seat_ = 0;
+  int players_ = 0;
+  Hand own_hand_;
+  std::array<int, kTileKinds> unseen_{};
+  std::array<int, kMaxPlayers> sizes_{};
+  int pile_ = 0;
+  std::array<uint16_t, kMaxPlayers> excluded_{};
+  std::array<std::array<double, kTileKinds>, kMaxPlayers> weights_{};
+};
+
+// Marginals for many trackers: tracker i writes kMaxPlayers * kTileKinds
+// values at expected / hold + i * kMaxPlayers * kTileKinds.
+void TrackerMarginals(const TileTracker* const* trackers, int count, float* expected, float* hold);
+
+}  // namespace tigerdragon
@@ -0,0 +1,270 @@
+#include "trajectory_shard.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tigerdragon {
+
+namespace {
+
+constexpr char kMagic[8] = {'T', 'D', 'T', 'R', 'A', 'J', '\0', '\0'};
+constexpr uint32_t kVersion = 1;
+constexpr uint64_t kChecksumSeed = 0x9E3779B97F4A7C15ULL;
+
+// Word-at-a-time multiply-rotate hash; `bytes` is a multiple of 8 since
+// records and index entries are.
+uint64_t UpdateChecksum(uint64_t hash, const uint8_t* data, size_t bytes) {
+  for (size_t i = 0; i + 8 <= bytes; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, data + i, sizeof(word));
+    hash ^= word * 0xC2B2AE3D27D4EB4FULL;
+    hash = ((hash << 31) | (hash >> 33)) * 0x9E3779B185EBCA87ULL;
+  }
+  return hash;
+}
+
+}  // namespace
+
+TrajectoryWriter::TrajectoryWriter(const std::string& directory, const std::string& prefix,
+                                   uint64_t max_shard_bytes, size_t buffer_bytes)
+    : directory_(directory),
+      prefix_(prefix),
+      max_shard_bytes_(max_shard_bytes),
+      buffer_(std::max(buffer_bytes, sizeof(TrajectoryRecord))) {}
+
+TrajectoryWriter::~TrajectoryWriter() {
+  Close();
+}
+
+bool TrajectoryWriter::AddGame(const TrajectoryRecord* records, size_t count) {
+  if (!ok_) {
+    return false;
+  }
+  if (count == 0) {
+    return true;
+  }
+  const uint64_t shard_bytes = sizeof(TrajectoryShardHeader) +
+                               (record_count_ + count) * sizeof(TrajectoryRecord) +
+                               (game_starts_.size() + 1) * sizeof(uint64_t);
+  if (file_ != nullptr && record_count_ > 0 && shard_bytes > max_shard_bytes_ && !FinishShard()) {
+    return false;
+  }
+  if (file_ == nullptr && !OpenShard()) {
+    return false;
+  }
+
+  game_starts_.push_back(record_count_);
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(records);
+  size_t bytes = count * sizeof(TrajectoryRecord);
+  checksum_ = UpdateChecksum(checksum_, data, bytes);
+  record_count_ += count;
+  while (bytes > 0) {
+    const size_t chunk = std::min(bytes, buffer_.size() - buffered_);
+    std::memcpy(buffer_.data() + buffered_, data, chunk);
+    buffered_ += chunk;
+    data += chunk;
+    bytes -= chunk;
+    if (buffered_ == buffer_.size() && !Flush()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool TrajectoryWriter::Close() {
+  if (file_ != nullptr) {
+    FinishShard();
+  }
+  return ok_;
+}
+
+bool TrajectoryWriter::OpenShard() {
+  char name[32];
+  std::snprintf(name, sizeof(name), "-%06d.tds", shard_number_);
+  const std::string path = (std::filesystem::path(directory_) / (prefix_ + name)).string();
+  temp_path_ = path + ".tmp";
+  file_ = std::fopen(temp_path_.c_str(), "wb");
+  if (file_ == nullptr) {
+    ok_ = false;
+    return false;
+  }
+  std::setvbuf(file_, nullptr, _IONBF, 0);
+  const TrajectoryShardHeader placeholder{};
+  ok_ = std::fwrite(&placeholder, sizeof(placeholder), 1, file_) == 1;
+  record_count_ = 0;
+  game_starts_.clear();
+  checksum_ = kChecksumSeed;
+  return ok_;
+}
+
+bool TrajectoryWriter::FinishShard() {
+  Flush();
+  const uint8_t* index = reinterpret_cast<const uint8_t*>(game_starts_.data());
+  const size_t index_bytes = game_starts_.size() * sizeof(uint64_t);
+  checksum_ = UpdateChecksum(checksum_, index, index_bytes);
+  if (ok_ && index_bytes > 0) {
+    ok_ = std::fwrite(index, index_bytes, 1, file_) == 1;
+  }
+
+  TrajectoryShardHeader header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.record_size = sizeof(TrajectoryRecord);
+  header.record_count = record_count_;
+  header.game_count = game_starts_.size();
+  header.index_offset = sizeof(TrajectoryShardHeader) + record_count_ * sizeof(TrajectoryRecord);
+  header.checksum = checksum_;
+  ok_ = ok_ && std::fseek(file_, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, file_) == 1;
+  ok_ = std::fclose(file_) == 0 && ok_;
+  file_ = nullptr;
+
+  const std::string path = temp_path_.substr(0, temp_path_.size() - 4);
+  ok_ = ok_ && std::rename(temp_path_.c_str(), path.c_str()) == 0;
+  if (ok_) {
+    shard_paths_.push_back(path);
+  }
+  ++shard_number_;
+  return ok_;
+}
+
+bool TrajectoryWriter::Flush() {
+  if (buffered_ > 0 && ok_) {
+    ok_ = std::fwrite(buffer_.data(), buffered_, 1, file_) == 1;
+  }
+  buffered_ = 0;
+  return ok_;
+}
+
+TrajectoryShard::~TrajectoryShard() {
+  Close();
+}
+
+TrajectoryShard::TrajectoryShard(TrajectoryShard&& other) noexcept {
+  *this = std::move(other);
+}
+
+TrajectoryShard& TrajectoryShard::operator=(TrajectoryShard&& other) noexcept {
+  if (this != &other) {
+    Close();
+    map_ = other.map_;
+    map_size_ = other.map_size_;
+    header_ = other.header_;
+    records_ = other.records_;
+    index_ = other.index_;
+    other.map_ = nullptr;
+    other.Close();
+  }
+  return *this;
+}
+
+bool TrajectoryShard::Open(const std::string& path) {
+  Close();
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(TrajectoryShardHeader)) {
+    close(fd);
+    return false;
+  }
+  void* map = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+  map_ = static_cast<const uint8_t*>(map);
+  map_size_ = static_cast<size_t>(info.st_size);
+
+  std::memcpy(&header_, map_, sizeof(header_));
+  const uint64_t index_offset = sizeof(TrajectoryShardHeader) + header_.record_count * sizeof(TrajectoryRecord);
+  if (std::memcmp(header_.magic, kMagic, sizeof(kMagic)) != 0 || header_.version != kVersion ||
+      header_.record_size != sizeof(TrajectoryRecord) || header_.index_offset != index_offset ||
+      map_size_ < index_offset + header_.game_count * sizeof(uint64_t)) {
+    Close();
+    return false;
+  }
+  records_ = reinterpret_cast<const TrajectoryRecord*>(map_ + sizeof(TrajectoryShardHeader));
+  index_ = reinterpret_cast<const uint64_t*>(map_ + index_offset);
+  madvise(map, map_size_, MADV_RANDOM);
+  return true;
+}
+
+void TrajectoryShard::Close() {
+  if (map_ != nullptr) {
+    munmap(const_cast<uint8_t*>(map_), map_size_);
+  }
+  map_ = nullptr;
+  map_size_ = 0;
+  header_ = TrajectoryShardHeader{};
+  records_ = nullptr;
+  index_ = nullptr;
+}
+
+bool TrajectoryShard::VerifyChecksum() const {
+  if (map_ == nullptr) {
+    return false;
+  }
+  const uint8_t* records = map_ + sizeof(TrajectoryShardHeader);
+  const uint64_t hash = UpdateChecksum(kChecksumSeed, records,
+                                       header_.record_count * sizeof(TrajectoryRecord) +
+                                           header_.game_count * sizeof(uint64_t));
+  return hash == header_.checksum;
+}
+
+bool TrajectoryReader::AddShard(const std::string& path) {
+  TrajectoryShard shard;
+  if (!shard.Open(path)) {
+    return false;
+  }
+  if (offsets_.empty()) {
+    offsets_.push_back(0);
+  }
+  offsets_.push_back(offsets_.back() + shard.size());
+  shards_.push_back(std::move(shard));
+  return true;
+}
+
+bool TrajectoryReader::AddDirectory(const std::string& directory) {
+  std::vector<std::string> paths;
+  std::error_code error;
+  for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+    if (entry.is_regular_file() && entry.path().extension() == ".tds") {
+      paths.push_back(entry.path().string());
+    }
+  }
+  if (error) {
+    return false;
+  }
+  std::sort(paths.begin(), paths.end());
+  for (const std::string& path : paths) {
+    if (!AddShard(path)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+const TrajectoryRecord& TrajectoryReader::Record(uint64_t index) const {
+  const size_t shard =
+      static_cast<size_t>(std::upper_bound(offsets_.begin(), offsets_.end(), index) - offsets_.begin()) - 1;
+  return shards_[shard][index - offsets_[shard]];
+}
+
+void TrajectoryReader::Sample(PhiloxEngine& rng, const TrajectoryRecord** out, int count) const {
+  const uint64_t total = size();
+  for (int i = 0; i < count; ++i) {
+    const uint64_t high = rng();
+    const uint64_t bits = (high << 32) | rng();
+    const uint64_t index = static_cast<uint64_t>((static_cast<unsigned __int128>(bits) * total) >> 64);
+    out[i] = &Record(index);
+  }
+}
+
+}  // namespace tigerdragon
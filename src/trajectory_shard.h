@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "observation.h"
+#include "rng.h"
+
+namespace tigerdragon {
+
+// One decision: the mover's observation, what it played, and how the round
+// ended for it.
+struct TrajectoryRecord {
+  uint8_t features[kObservationFeatures];  // EncodeObservation, uint8 form.
+  uint8_t action = 0;                      // ActionCode of the move played.
+  uint8_t seat = 0;
+  int8_t outcome = 0;  // 1 the mover won the round, -1 someone else did, 0 no winner.
+  uint16_t legal_mask = 0;  // LegalCodeMask.
+  uint16_t ply = 0;
+  uint64_t game = 0;
+};
+
+static_assert(sizeof(TrajectoryRecord) == 80, "record layout is part of the shard format");
+
+// Shard layout: a 64-byte header, the records, then one uint64 per game
+// giving the index of its first record. The checksum covers records and
+// index.
+struct TrajectoryShardHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t record_count;
+  uint64_t game_count;
+  uint64_t index_offset;
+  uint64_t checksum;
+  uint64_t reserved[2];
+};
+
+static_assert(sizeof(TrajectoryShardHeader) == 64, "header layout is part of the shard format");
+
+// Appends games to numbered shards (prefix-000000.tds, ...) in `directory`
+// through a large staging buffer. A shard is written under a .tmp name and
+// renamed once its header is final, and a new one is started when the
+// current shard would exceed max_shard_bytes. Games never straddle shards.
+class TrajectoryWriter {
+ public:
+  TrajectoryWriter(const std::string& directory, const std::string& prefix,
+                   uint64_t max_shard_bytes = uint64_t{256} << 20, size_t buffer_bytes = size_t{4} << 20);
+  ~TrajectoryWriter();
+
+  TrajectoryWriter(const TrajectoryWriter&) = delete;
+  TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+  bool AddGame(const TrajectoryRecord* records, size_t count);
+  // Finishes the current shard. Returns false if any write failed.
+  bool Close();
+
+  bool ok() const { return ok_; }
+  const std::vector<std::string>& shard_paths() const { return shard_paths_; }
+
+ private:
+  bool OpenShard();
+  bool FinishShard();
+  bool Flush();
+
+  std::string directory_;
+  std::string prefix_;
+  uint64_t max_shard_bytes_;
+  std::vector<uint8_t> buffer_;
+  size_t buffered_ = 0;
+  std::FILE* file_ = nullptr;
+  std::string temp_path_;
+  uint64_t record_count_ = 0;
+  std::vector<uint64_t> game_starts_;
+  uint64_t checksum_ = 0;
+  int shard_number_ = 0;
+  bool ok_ = true;
+  std::vector<std::string> shard_paths_;
+};
+
+// A finished shard, mapped read-only.
+class TrajectoryShard {
+ public:
+  TrajectoryShard() = default;
+  ~TrajectoryShard();
+
+  TrajectoryShard(TrajectoryShard&& other) noexcept;
+  TrajectoryShard& operator=(TrajectoryShard&& other) noexcept;
+  TrajectoryShard(const TrajectoryShard&) = delete;
+  TrajectoryShard& operator=(const TrajectoryShard&) = delete;
+
+  // Checks the header and size only; VerifyChecksum reads the whole file.
+  bool Open(const std::string& path);
+  void Close();
+  bool VerifyChecksum() const;
+
+  uint64_t size() const { return header_.record_count; }
+  uint64_t game_count() const { return header_.game_count; }
+  const TrajectoryRecord& operator[](uint64_t index) const { return records_[index]; }
+  uint64_t GameStart(uint64_t game) const { return index_[game]; }
+
+ private:
+  const uint8_t* map_ = nullptr;
+  size_t map_size_ = 0;
+  TrajectoryShardHeader header_{};
+  const TrajectoryRecord* records_ = nullptr;
+  const uint64_t* index_ = nullptr;
+};
+
+// A set of shards sampled as one record array.
+class TrajectoryReader {
+ public:
+  bool AddShard(const std::string& path);
+  // Adds every *.tds file in `directory`, in name order.
+  bool AddDirectory(const std::string& directory);
+
+  uint64_t size() const { return offsets_.empty() ? 0 : offsets_.back(); }
+  const TrajectoryRecord& Record(uint64_t index) const;
+
+  // Fills out[0..count) with records drawn uniformly with replacement.
+  // Requires size() > 0.
+  void Sample(PhiloxEngine& rng, const TrajectoryRecord** out, int count) const;
+
+ private:
+  std::vector<TrajectoryShard> shards_;
+  std::vector<uint64_t> offsets_;  // offsets_[i + 1] = records in shards 0..i.
+};
+
+}  // namespace tigerdragon
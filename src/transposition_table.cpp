@@ -0,0 +1,107 @@
+#include "transposition_table.h"
+
+namespace tigerdragon {
+
+namespace {
+
+// data layout: value:16 | depth:8 | bound:8 | move:8 | generation:8.
+constexpr int kDepthShift = 16;
+constexpr int kBoundShift = 24;
+constexpr int kMoveShift = 32;
+constexpr int kGenerationShift = 40;
+
+}  // namespace
+
+TranspositionTable::TranspositionTable(size_t megabytes) {
+  size_t buckets = 1;
+  const size_t target = (megabytes << 20) / sizeof(Bucket);
+  while (buckets * 2 <= target) {
+    buckets *= 2;
+  }
+  bucket_count_ = buckets;
+  buckets_ = std::make_unique<Bucket[]>(bucket_count_);
+}
+
+uint64_t TranspositionTable::Pack(const Entry& entry, uint8_t generation) {
+  return static_cast<uint64_t>(static_cast<uint16_t>(entry.value)) |
+         (static_cast<uint64_t>(entry.depth) << kDepthShift) |
+         (static_cast<uint64_t>(entry.bound) << kBoundShift) |
+         (static_cast<uint64_t>(entry.move) << kMoveShift) |
+         (static_cast<uint64_t>(generation) << kGenerationShift);
+}
+
+TranspositionTable::Entry TranspositionTable::Unpack(uint64_t data) {
+  Entry entry;
+  entry.value = static_cast<int16_t>(data & 0xFFFF);
+  entry.depth = static_cast<uint8_t>(data >> kDepthShift);
+  entry.bound = static_cast<Bound>((data >> kBoundShift) & 0xFF);
+  entry.move = static_cast<uint8_t>(data >> kMoveShift);
+  return entry;
+}
+
+uint8_t TranspositionTable::GenerationOf(uint64_t data) {
+  return static_cast<uint8_t>(data >> kGenerationShift);
+}
+
+bool TranspositionTable::Probe(uint64_t key, Entry* out) const {
+  const Bucket& bucket = buckets_[key & (bucket_count_ - 1)];
+  for (const Slot& slot : bucket.slots) {
+    const uint64_t data = slot.data.load(std::memory_order_relaxed);
+    const uint64_t check = slot.check.load(std::memory_order_relaxed);
+    if (data != 0 && (check ^ data) == key) {
+      *out = Unpack(data);
+      return true;
+    }
+  }
+  return false;
+}
+
+void TranspositionTable::Store(uint64_t key, const Entry& entry) {
+  Bucket& bucket = buckets_[key & (bucket_count_ - 1)];
+  const uint8_t generation = generation_.load(std::memory_order_relaxed);
+
+  // Same key first, then an empty slot, then the shallowest/oldest entry.
+  Slot* victim = nullptr;
+  int victim_score = 0;
+  for (Slot& slot : bucket.slots) {
+    const uint64_t data = slot.data.load(std::memory_order_relaxed);
+    const uint64_t check = slot.check.load(std::memory_order_relaxed);
+    if (data == 0 || (check ^ data) == key) {
+      if (data != 0 && Unpack(data).depth > entry.depth && entry.bound != Bound::Exact &&
+          GenerationOf(data) == generation) {
+        return;
+      }
+      victim = &slot;
+      break;
+    }
+    const int age = static_cast<uint8_t>(generation - GenerationOf(data));
+    const int score = Unpack(data).depth - 8 * age;
+    if (victim == nullptr || score < victim_score) {
+      victim = &slot;
+      victim_score = score;
+    }
+  }
+
+  const uint64_t data = Pack(entry, generation);
+  victim->check.store(key ^ data, std::memory_order_relaxed);
+  victim->data.store(data, std::memory_order_relaxed);
+}
+
+void TranspositionTable::NewSearch() {
+  uint8_t next = static_cast<uint8_t>(generation_.load(std::memory_order_relaxed) + 1);
+  if (next == 0) {
+    next = 1;
+  }
+  generation_.store(next, std::memory_order_relaxed);
+}
+
+void TranspositionTable::Clear() {
+  for (size_t i = 0; i < bucket_count_; ++i) {
+    for (Slot& slot : buckets_[i].slots) {
+      slot.check.store(0, std::memory_order_relaxed);
+      slot.data.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+}  // namespace tigerdragon
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace tigerdragon {
+
+// Fixed-size, lock-free hash table shared by search threads. Each slot
+// stores (key ^ data, data) so a torn write from a concurrent Store is
+// detected on Probe and treated as a miss.
+class TranspositionTable {
+ public:
+  enum class Bound : uint8_t {
+    None,
+    Exact,
+    Lower,
+    Upper,
+  };
+
+  struct Entry {
+    int16_t value = 0;
+    uint8_t depth = 0;
+    Bound bound = Bound::None;
+    uint8_t move = 0xFF;  // ActionCode, 0xFF when unknown.
+  };
+
+  explicit TranspositionTable(size_t megabytes);
+
+  bool Probe(uint64_t key, Entry* out) const;
+  void Store(uint64_t key, const Entry& entry);
+
+  // Starts a new search generation; entries from older generations are
+  // replaced first.
+  void NewSearch();
+  void Clear();
+
+  size_t BucketCount() const { return bucket_count_; }
+
+ private:
+  static constexpr int kSlotsPerBucket = 4;
+
+  struct Slot {
+    std::atomic<uint64_t> check{0};
+    std::atomic<uint64_t> data{0};
+  };
+
+  struct alignas(64) Bucket {
+    Slot slots[kSlotsPerBucket];
+  };
+
+  static uint64_t Pack(const Entry& entry, uint8_t generation);
+  static Entry Unpack(uint64_t data);
+  static uint8_t GenerationOf(uint64_t data);
+
+  std::unique_ptr<Bucket[]> buckets_;
+  size_t bucket_count_ = 0;
+  std::atomic<uint8_t> generation_{1};
+};
+
+}  // namespace tigerdragon
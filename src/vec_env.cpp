@@ -0,0 +1,90 @@
+#include "vec_env.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace tigerdragon {
+
+VecEnv::VecEnv(const VecEnvConfig& config) : config_(config) {
+  pool_ = std::make_unique<WorkStealingPool>(config_.threads);
+  // A few blocks per worker keeps stealing useful without paying the
+  // dispatch cost per env.
+  block_size_ = std::max(1, config_.envs / (pool_->threads() * 8));
+
+  const size_t envs = static_cast<size_t>(config_.envs);
+  states_.resize(envs);
+  deals_.assign(envs, 0);
+  observations_.assign(envs * kObservationFeatures, 0.0f);
+  rewards_.assign(envs * config_.players, 0.0f);
+  dones_.assign(envs, 0);
+  legal_masks_.assign(envs, 0);
+  current_players_.assign(envs, 0);
+  Reset();
+}
+
+void VecEnv::Reset() {
+  ForEachEnv([this](int env) {
+    ResetEnv(env);
+    std::fill_n(rewards_.begin() + static_cast<size_t>(env) * config_.players, config_.players, 0.0f);
+    dones_[env] = 0;
+    Publish(env);
+  });
+}
+
+void VecEnv::Step(const uint8_t* actions) {
+  ForEachEnv([this, actions](int env) { StepEnv(env, actions[env]); });
+}
+
+int64_t VecEnv::episodes() const {
+  return std::accumulate(deals_.begin(), deals_.end(), int64_t{0});
+}
+
+void VecEnv::ResetEnv(int env) {
+  GameConfig config;
+  config.players = config_.players;
+  config.seed = config_.seed;
+  config.rng = GameConfig::Rng::Philox;
+  config.deal_index = static_cast<uint64_t>(env) << 32 | deals_[env]++;
+  states_[env] = CreateInitialState(config);
+}
+
+void VecEnv::StepEnv(int env, uint8_t action) {
+  GameState& state = states_[env];
+  float* rewards = rewards_.data() + static_cast<size_t>(env) * config_.players;
+  std::fill_n(rewards, config_.players, 0.0f);
+  dones_[env] = 0;
+
+  if (action > kPassCode || (legal_masks_[env] >> action & 1) == 0 ||
+      !ApplyAction(state, ActionFromCode(state, action))) {
+    return;
+  }
+  if (state.finished) {
+    for (int seat = 0; seat < config_.players; ++seat) {
+      rewards[seat] = seat == state.winner ? 1.0f : -1.0f;
+    }
+    dones_[env] = 1;
+    ResetEnv(env);
+  }
+  Publish(env);
+}
+
+void VecEnv::Publish(int env) {
+  const GameState& state = states_[env];
+  const ObservationView view(state, state.current_player);
+  EncodeObservation(view, observations_.data() + static_cast<size_t>(env) * kObservationFeatures);
+  legal_masks_[env] = view.legal_mask();
+  current_players_[env] = state.current_player;
+}
+
+void VecEnv::ForEachEnv(const std::function<void(int)>& fn) {
+  const int64_t blocks = (config_.envs + block_size_ - 1) / block_size_;
+  pool_->ParallelFor(blocks, [&](int64_t block, int) {
+    const int begin = static_cast<int>(block * block_size_);
+    const int end = std::min(config_.envs, begin + block_size_);
+    for (int env = begin; env < end; ++env) {
+      fn(env);
+    }
+  });
+}
+
+}  // namespace tigerdragon
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "engine.h"
+#include "observation.h"
+#include "work_stealing_pool.h"
+
+namespace tigerdragon {
+
+struct VecEnvConfig {
+  int envs = 64;
+  int players = 2;
+  // Philox key for every deal (GameConfig::seed).
+  uint32_t seed = 0;
+  // Stepping threads; <= 0 uses every core.
+  int threads = 1;
+};
+
+// M independent rounds stepped together for training loops. All outputs
+// live in buffers allocated once by the constructor; the pointers stay
+// valid (and are overwritten in place) for the lifetime of the VecEnv.
+//
+// Each env is seen by its player to move: observations and legal masks
+// are for current_players()[i]. Env i deals episode k from
+// Philox(seed, deal_index = i << 32 | k), so results do not depend on the
+// thread count.
+class VecEnv {
+ public:
+  explicit VecEnv(const VecEnvConfig& config);
+
+  VecEnv(const VecEnv&) = delete;
+  VecEnv& operator=(const VecEnv&) = delete;
+
+  int envs() const { return config_.envs; }
+  int players() const { return config_.players; }
+
+  // Redeals every env and clears rewards and dones.
+  void Reset();
+
+  // actions[i] is a move code (ActionCode) for env i. An illegal code
+  // leaves env i unchanged with zero reward. When a move ends the round,
+  // rewards[i * players() + seat] is +1 for the winner and -1 for every
+  // other seat, dones[i] is 1 and the env is redealt before Step returns,
+  // so its observation is already the new round's.
+  void Step(const uint8_t* actions);
+
+  // envs() * kObservationFeatures.
+  const float* observations() const { return observations_.data(); }
+  // envs() * players(), by absolute seat.
+  const float* rewards() const { return rewards_.data(); }
+  const uint8_t* dones() const { return dones_.data(); }
+  // LegalCodeMask per env.
+  const uint16_t* legal_masks() const { return legal_masks_.data(); }
+  const int32_t* current_players() const { return current_players_.data(); }
+
+  const GameState& state(int env) const { return states_[env]; }
+  int64_t episodes() const;
+
+ private:
+  void ResetEnv(int env);
+  void StepEnv(int env, uint8_t action);
+  void Publish(int env);
+  // Calls fn(env) for every env, in blocks spread over the pool.
+  void ForEachEnv(const std::function<void(int)>& fn);
+
+  VecEnvConfig config_;
+  std::unique_ptr<WorkStealingPool> pool_;
+  int block_size_ = 1;
+
+  std::vector<GameState> states_;
+  std::vector<uint32_t> deals_;
+  std::vector<float> observations_;
+  std::vector<float> rewards_;
+  std::vector<uint8_t> dones_;
+  std::vector<uint16_t> legal_masks_;
+  std::vector<int32_t> current_players_;
+};
+
+}  // namespace tigerdragon
@@ -0,0 +1,46 @@
+#include "vec_env_c.h"
+
+#include <new>
+
+#include "vec_env.h"
+
+struct td_vec_env {
+  explicit td_vec_env(const tigerdragon::VecEnvConfig& config) : impl(config) {}
+  tigerdragon::VecEnv impl;
+};
+
+extern "C" {
+
+td_vec_env* td_vec_env_create(int envs, int players, uint32_t seed, int threads) {
+  if (envs <= 0 || players < 2 || players > tigerdragon::kMaxPlayers) {
+    return nullptr;
+  }
+  tigerdragon::VecEnvConfig config;
+  config.envs = envs;
+  config.players = players;
+  config.seed = seed;
+  config.threads = threads;
+  try {
+    return new td_vec_env(config);
+  } catch (const std::bad_alloc&) {
+    return nullptr;
+  }
+}
+
+void td_vec_env_destroy(td_vec_env* env) { delete env; }
+
+int td_vec_env_envs(const td_vec_env* env) { return env->impl.envs(); }
+int td_vec_env_players(const td_vec_env* env) { return env->impl.players(); }
+int td_vec_env_observation_size(void) { return tigerdragon::kObservationFeatures; }
+int td_vec_env_action_count(void) { return tigerdragon::kMaxLegalActions; }
+
+void td_vec_env_reset(td_vec_env* env) { env->impl.Reset(); }
+void td_vec_env_step(td_vec_env* env, const uint8_t* actions) { env->impl.Step(actions); }
+
+const float* td_vec_env_observations(const td_vec_env* env) { return env->impl.observations(); }
+const float* td_vec_env_rewards(const td_vec_env* env) { return env->impl.rewards(); }
+const uint8_t* td_vec_env_dones(const td_vec_env* env) { return env->impl.dones(); }
+const uint16_t* td_vec_env_legal_masks(const td_vec_env* env) { return env->impl.legal_masks(); }
+const int32_t* td_vec_env_current_players(const td_vec_env* env) { return env->impl.current_players(); }
+
+}  // extern "C"
@@ -0,0 +1,35 @@
+/* C interface to tigerdragon::VecEnv for external trainers (ctypes, cffi,
+ * ...). Buffers returned by the accessors belong to the env, stay valid
+ * until td_vec_env_destroy and are rewritten in place by reset/step. */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct td_vec_env td_vec_env;
+
+/* Returns NULL on invalid arguments. threads <= 0 uses every core. */
+td_vec_env* td_vec_env_create(int envs, int players, uint32_t seed, int threads);
+void td_vec_env_destroy(td_vec_env* env);
+
+int td_vec_env_envs(const td_vec_env* env);
+int td_vec_env_players(const td_vec_env* env);
+int td_vec_env_observation_size(void);
+int td_vec_env_action_count(void);
+
+void td_vec_env_reset(td_vec_env* env);
+/* actions: envs move codes (tile kind 0-9, 10 = pass). */
+void td_vec_env_step(td_vec_env* env, const uint8_t* actions);
+
+const float* td_vec_env_observations(const td_vec_env* env);
+const float* td_vec_env_rewards(const td_vec_env* env);
+const uint8_t* td_vec_env_dones(const td_vec_env* env);
+const uint16_t* td_vec_env_legal_masks(const td_vec_env* env);
+const int32_t* td_vec_env_current_players(const td_vec_env* env);
+
+#ifdef __cplusplus
+}
+#endif
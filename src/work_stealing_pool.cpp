@@ -0,0 +1,121 @@
+#include "work_stealing_pool.h"
+
+namespace tigerdragon {
+
+WorkStealingPool::WorkStealingPool(int threads) {
+  if (threads <= 0) {
+    threads = static_cast<int>(std::thread::hardware_concurrency());
+  }
+  if (threads <= 0) {
+    threads = 1;
+  }
+  for (int i = 0; i < threads; ++i) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  for (int worker = 1; worker < threads; ++worker) {
+    threads_.emplace_back([this, worker] { WorkerLoop(worker); });
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void WorkStealingPool::ParallelFor(int64_t count, const std::function<void(int64_t, int)>& fn) {
+  if (count <= 0) {
+    return;
+  }
+  const int workers = threads();
+  for (int worker = 0; worker < workers; ++worker) {
+    Queue& queue = *queues_[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.begin = count * worker / workers;
+    queue.end = count * (worker + 1) / workers;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    job_ = &fn;
+    active_ = workers;
+    ++generation_;
+  }
+  wake_.notify_all();
+
+  RunJob(0);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_.wait(lock, [this] { return active_ == 0; });
+  job_ = nullptr;
+}
+
+void WorkStealingPool::WorkerLoop(int worker) {
+  uint64_t seen = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+      if (stopping_) {
+        return;
+      }
+      seen = generation_;
+    }
+    RunJob(worker);
+  }
+}
+
+void WorkStealingPool::RunJob(int worker) {
+  const auto& fn = *job_;
+  int64_t index = 0;
+  while (PopLocal(worker, &index) || Steal(worker, &index)) {
+    fn(index, worker);
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (--active_ == 0) {
+    idle_.notify_all();
+  }
+}
+
+bool WorkStealingPool::PopLocal(int worker, int64_t* index) {
+  Queue& queue = *queues_[worker];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.begin >= queue.end) {
+    return false;
+  }
+  *index = queue.begin++;
+  return true;
+}
+
+bool WorkStealingPool::Steal(int worker, int64_t* index) {
+  const int workers = threads();
+  for (int offset = 1; offset < workers; ++offset) {
+    Queue& victim = *queues_[(worker + offset) % workers];
+    int64_t begin = 0;
+    int64_t end = 0;
+    {
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      const int64_t remaining = victim.end - victim.begin;
+      if (remaining <= 0) {
+        continue;
+      }
+      const int64_t take = (remaining + 1) / 2;
+      end = victim.end;
+      begin = end - take;
+      victim.end = begin;
+    }
+    Queue& own = *queues_[worker];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    *index = begin;
+    own.begin = begin + 1;
+    own.end = end;
+    return true;
+  }
+  return false;
+}
+
+}  // namespace tigerdragon
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tigerdragon {
+
+// Persistent worker pool for index-parallel loops. Each worker starts with
+// a contiguous slice of the index range and, once it runs dry, steals the
+// back half of the next non-empty slice.
+class WorkStealingPool {
+ public:
+  // threads <= 0 uses std::thread::hardware_concurrency(). The calling
+  // thread counts as worker 0.
+  explicit WorkStealingPool(int threads);
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  int threads() const { return static_cast<int>(queues_.size()); }
+
+  // Calls fn(index, worker) once for every index in [0, count) and returns
+  // when all calls have finished. Not reentrant.
+  void ParallelFor(int64_t count, const std::function<void(int64_t, int)>& fn);
+
+ private:
+  struct alignas(64) Queue {
+    std::mutex mutex;
+    int64_t begin = 0;
+    int64_t end = 0;
+  };
+
+  void WorkerLoop(int worker);
+  void RunJob(int worker);
+  bool PopLocal(int worker, int64_t* index);
+  bool Steal(int worker, int64_t* index);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable idle_;
+  const std::function<void(int64_t, int)>* job_ = nullptr;
+  uint64_t generation_ = 0;
+  int active_ = 0;
+  bool stopping_ = false;
+};
+
+}  // namespace tigerdragon